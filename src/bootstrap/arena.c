@@ -16,9 +16,15 @@ static ArenaBlock *arena_new_block(size_t cap) {
 
 void arena_init(Arena *arena) {
     arena->head = NULL;
+    arena->cleanups = NULL;
 }
 
 void arena_free(Arena *arena) {
+    // Cleanup records live in the blocks, so run them first.
+    for (ArenaCleanup *c = arena->cleanups; c; c = c->next) {
+        c->fn(c->ptr, c->len);
+    }
+    arena->cleanups = NULL;
     ArenaBlock *block = arena->head;
     while (block) {
         ArenaBlock *next = block->next;
@@ -52,3 +58,16 @@ void *arena_alloc_zero(Arena *arena, size_t size) {
     }
     return ptr;
 }
+
+bool arena_on_free(Arena *arena, void (*fn)(void *ptr, size_t len), void *ptr, size_t len) {
+    ArenaCleanup *c = (ArenaCleanup *)arena_alloc(arena, sizeof(ArenaCleanup));
+    if (!c) {
+        return false;
+    }
+    c->fn = fn;
+    c->ptr = ptr;
+    c->len = len;
+    c->next = arena->cleanups;
+    arena->cleanups = c;
+    return true;
+}
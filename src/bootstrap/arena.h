@@ -1,6 +1,7 @@
 #ifndef YIS_ARENA_H
 #define YIS_ARENA_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 typedef struct ArenaBlock {
@@ -10,13 +11,24 @@ typedef struct ArenaBlock {
     unsigned char data[];
 } ArenaBlock;
 
+typedef struct ArenaCleanup {
+    struct ArenaCleanup *next;
+    void (*fn)(void *ptr, size_t len);
+    void *ptr;
+    size_t len;
+} ArenaCleanup;
+
 typedef struct {
     ArenaBlock *head;
+    ArenaCleanup *cleanups;
 } Arena;
 
 void arena_init(Arena *arena);
 void arena_free(Arena *arena);
 void *arena_alloc(Arena *arena, size_t size);
 void *arena_alloc_zero(Arena *arena, size_t size);
+// Runs fn(ptr, len) when the arena is freed, for resources its allocations
+// point into (e.g. a mapped source file).
+bool arena_on_free(Arena *arena, void (*fn)(void *ptr, size_t len), void *ptr, size_t len);
 
 #endif
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "arena.h"
 #include "lexer.h"
@@ -37,12 +38,14 @@ typedef struct {
 
 typedef struct {
     Str name;
+    uint32_t name_hash;  // str_hash(name) from the lexer, 0 if not recorded
     TypeRef *typ;
     bool is_mut;
     bool is_this;
 } Param;
 
 typedef struct Stmt Stmt;
+typedef struct Ty Ty;
 
 // --- Expressions ---
 
@@ -93,6 +96,7 @@ typedef struct {
 
 typedef struct {
     Str name;
+    uint32_t hash;  // str_hash(name) from the lexer, 0 if not recorded
 } ExprIdent;
 
 typedef struct {
@@ -212,6 +216,10 @@ struct Expr {
     ExprKind kind;
     int line;
     int col;
+    // Type inferred by typecheck_program, or NULL if the node was never
+    // checked (or failed to check). Codegen reads this instead of re-running
+    // inference over the subtree.
+    Ty *ty;
     union {
         ExprInt int_lit;
         ExprFloat float_lit;
@@ -278,12 +286,14 @@ typedef enum {
 
 typedef struct {
     Str name;
+    uint32_t name_hash;
     bool is_mut;
     Expr *expr;
 } StmtLet;
 
 typedef struct {
     Str name;
+    uint32_t name_hash;
     Expr *expr;
 } StmtConst;
 
@@ -306,6 +316,7 @@ typedef struct {
 
 typedef struct {
     Str name;
+    uint32_t name_hash;
     Expr *expr;
     Stmt *body;
 } StmtForEach;
@@ -381,12 +392,14 @@ typedef struct {
 
 typedef struct {
     Str name;
+    uint32_t name_hash;
     Expr *expr;
     bool is_pub;
 } ConstDecl;
 
 typedef struct {
     Str name;
+    uint32_t name_hash;
     Expr *expr;
     bool is_mut;
     bool is_pub;
@@ -224,71 +224,6 @@ static char *arena_printf(Arena *arena, const char *fmt, ...) {
     return buf;
 }
 
-// -----------------
-// Simple hash map (Str -> size_t index)
-// -----------------
-
-static uint32_t str_hash(Str s) {
-    uint32_t h = 2166136261u;
-    for (size_t i = 0; i < s.len; i++) {
-        h ^= (uint8_t)s.data[i];
-        h *= 16777619u;
-    }
-    return h;
-}
-
-typedef struct {
-    Str key;
-    size_t value;
-    bool occupied;
-} StrMapEntry;
-
-typedef struct {
-    StrMapEntry *entries;
-    size_t cap;
-    size_t len;
-} StrMap;
-
-static void strmap_init(StrMap *m, Arena *arena, size_t expected) {
-    size_t cap = 16;
-    while (cap < expected * 2) cap *= 2;
-    m->entries = (StrMapEntry *)arena_alloc(arena, sizeof(StrMapEntry) * cap);
-    memset(m->entries, 0, sizeof(StrMapEntry) * cap);
-    m->cap = cap;
-    m->len = 0;
-}
-
-static void strmap_put(StrMap *m, Str key, size_t value) {
-    uint32_t idx = str_hash(key) & (uint32_t)(m->cap - 1);
-    for (;;) {
-        if (!m->entries[idx].occupied) {
-            m->entries[idx].key = key;
-            m->entries[idx].value = value;
-            m->entries[idx].occupied = true;
-            m->len++;
-            return;
-        }
-        if (str_eq(m->entries[idx].key, key)) {
-            m->entries[idx].value = value;
-            return;
-        }
-        idx = (idx + 1) & (uint32_t)(m->cap - 1);
-    }
-}
-
-static bool strmap_get(StrMap *m, Str key, size_t *out) {
-    if (!m->entries || m->len == 0) return false;
-    uint32_t idx = str_hash(key) & (uint32_t)(m->cap - 1);
-    for (;;) {
-        if (!m->entries[idx].occupied) return false;
-        if (str_eq(m->entries[idx].key, key)) {
-            *out = m->entries[idx].value;
-            return true;
-        }
-        idx = (idx + 1) & (uint32_t)(m->cap - 1);
-    }
-}
-
 static char *c_escape(Arena *arena, Str s) {
     StrBuf b;
     sb_init(&b);
@@ -419,6 +354,8 @@ typedef struct {
     char *continue_label;
 } LoopCtx;
 
+typedef VEC(Str) StrVec;
+
 typedef struct {
     Program *prog;
     GlobalEnv *env;
@@ -442,6 +379,8 @@ typedef struct {
 
     Locals ty_loc;
 
+    StrVec boxed_names;  // names captured by a lambda in the current body
+
     Str current_cask;
     Str *current_imports;
     size_t current_imports_len;
@@ -451,6 +390,10 @@ typedef struct {
     Str entry_path;  // Path to the entry script file
     bool has_exit;   // Whether an exit/destructor function was found
 
+    Module *unit_mod;         // split build: only this module's definitions are emitted
+    const char *unit_header;  // split build: shared header the unit includes
+    bool header_only;         // split build: emit the shared header itself
+
     LambdaInfo *lambdas;
     size_t lambdas_len;
     size_t lambdas_cap;
@@ -468,17 +411,31 @@ typedef struct {
     size_t loop_stack_cap;
 
     // Hash map caches for env lookups
-    StrMap class_map;       // qname -> index into env->classes
-    StrMap fun_map;         // "cask\0name" -> index into env->funs
-    StrMap cask_globals_map; // cask -> index into env->cask_globals
-    StrMap cask_consts_map;  // cask -> index into env->cask_consts
-    StrMap cask_imports_map; // cask -> index into env->cask_imports
 
     // #line directive tracking (avoid redundant directives)
     int last_line_num;
     Str last_line_file;
 } Codegen;
 
+// Split builds give module-level symbols external linkage so units can link.
+static const char *codegen_linkage(Codegen *cg) {
+    return cg->unit_mod || cg->header_only ? "" : "static ";
+}
+
+static bool codegen_emits_module(Codegen *cg, Module *m) {
+    return !cg->unit_mod || cg->unit_mod == m;
+}
+
+static Module *codegen_decl_module(Codegen *cg, DeclKind kind) {
+    for (size_t i = 0; i < cg->prog->mods_len; i++) {
+        Module *m = cg->prog->mods[i];
+        for (size_t j = 0; j < m->decls_len; j++) {
+            if (m->decls[j]->kind == kind) return m;
+        }
+    }
+    return NULL;
+}
+
 static char *codegen_c_class_name(Codegen *cg, Str qname) {
     Str mod, name;
     split_qname(qname, &mod, &name);
@@ -583,6 +540,7 @@ static bool codegen_add_local(Codegen *cg, char *cname, bool is_ref) {
 static ModuleGlobals *codegen_cask_globals(Codegen *cg, Str cask);
 static GlobalVar *codegen_find_global(ModuleGlobals *mg, Str name);
 static bool gen_stmt(Codegen *cg, Str path, Stmt *s, bool ret_void, Diag *err);
+static bool codegen_is_boxed(Codegen *cg, Str name);
 
 static char *codegen_cname_of(Codegen *cg, Str name) {
     for (size_t i = cg->scopes_len; i-- > 0;) {
@@ -617,6 +575,7 @@ static char *codegen_new_lambda(Codegen *cg) {
     return arena_printf(cg->arena, "yis_lambda_%d", cg->lambda_id);
 }
 
+// Declares a let/const/foreach local and returns the C lvalue holding its value.
 static char *codegen_define_local(Codegen *cg, Str name, Ty *ty, bool is_mut, bool is_const) {
     cg->var_id++;
     size_t n_digits = 1;
@@ -632,15 +591,41 @@ static char *codegen_define_local(Codegen *cg, Str name, Ty *ty, bool is_mut, bo
     buf[name.len] = '_';
     buf[name.len + 1] = '_';
     snprintf(buf + name.len + 2, n_digits + 1, "%d", cg->var_id);
-    char *slot = arena_printf(cg->arena, "%s->val", buf);
 
     Binding b = { ty, is_mut, is_const, false };
     locals_define(&cg->ty_loc, name, b);
-    if (!codegen_add_name(cg, name, slot, buf)) return NULL;
-    if (!codegen_add_local(cg, buf, true)) return NULL;
+    if (codegen_is_boxed(cg, name)) {
+        // Captured by a lambda: the closure env shares this YisRef.
+        char *slot = arena_printf(cg->arena, "%s->val", buf);
+        if (!codegen_add_name(cg, name, slot, buf)) return NULL;
+        if (!codegen_add_local(cg, buf, true)) return NULL;
+        w_line(&cg->w, "YisRef* %s = yis_ref_new();", buf);
+        return slot;
+    }
+    if (!codegen_add_name(cg, name, buf, NULL)) return NULL;
+    if (!codegen_add_local(cg, buf, false)) return NULL;
+    w_line(&cg->w, "YisVal %s = YV_NULLV;", buf);
     return buf;
 }
 
+// Copies an incoming argument into the local `local`, boxing it only when a
+// lambda in the body captures the parameter.
+static bool codegen_bind_param(Codegen *cg, Str name, const char *local, const char *arg) {
+    if (codegen_is_boxed(cg, name)) {
+        char *rname = arena_printf(cg->arena, "%s", local);
+        char *slot = arena_printf(cg->arena, "%s->val", local);
+        if (!rname || !slot) return false;
+        w_line(&cg->w, "YisRef* %s = yis_ref_new();", rname);
+        w_line(&cg->w, "yis_move_into(&%s, %s);", slot, arg);
+        return codegen_add_name(cg, name, slot, rname) && codegen_add_local(cg, rname, true);
+    }
+    char *cname = arena_printf(cg->arena, "%s", local);
+    if (!cname) return false;
+    w_line(&cg->w, "YisVal %s = YV_NULLV;", cname);
+    w_line(&cg->w, "yis_move_into(&%s, %s);", cname, arg);
+    return codegen_add_name(cg, name, cname, NULL) && codegen_add_local(cg, cname, false);
+}
+
 static bool codegen_bind_temp(Codegen *cg, Str name, char *cname, Ty *ty) {
     Binding b = { ty, false, false, false };
     locals_define(&cg->ty_loc, name, b);
@@ -661,7 +646,7 @@ static void codegen_release_scope(Codegen *cg, LocalList locals) {
 
 // Emit release calls for all locals in all current scopes without
 // popping them.  Used by STMT_RETURN so that an early 'return' does
-// not skip cleanup of scope-tracked locals (YisRef* from let/const/params).
+// not skip cleanup of scope-tracked locals (let/const/params, boxed or not).
 static void codegen_emit_all_scope_releases(Codegen *cg) {
     for (size_t s = cg->scope_locals_len; s-- > 0;) {
         LocalList *ll = &cg->scope_locals[s];
@@ -737,7 +722,7 @@ static Str codegen_cask_name(Codegen *cg, Str path) {
 
 static ModuleImport *codegen_cask_imports(Codegen *cg, Str cask_name) {
     size_t idx;
-    if (strmap_get(&cg->cask_imports_map, cask_name, &idx)) {
+    if (strmap_get(&cg->env->cask_imports_map, cask_name, &idx)) {
         return &cg->env->cask_imports[idx];
     }
     return NULL;
@@ -754,31 +739,25 @@ static ClassDecl *codegen_class_decl(Codegen *cg, Str qname) {
 
 static ClassInfo *codegen_class_info(Codegen *cg, Str qname) {
     size_t idx;
-    if (strmap_get(&cg->class_map, qname, &idx)) {
+    if (strmap_get(&cg->env->class_map, qname, &idx)) {
         return &cg->env->classes[idx];
     }
     return NULL;
 }
 
 static FunSig *codegen_fun_sig(Codegen *cg, Str cask, Str name) {
-    size_t klen = cask.len + 1 + name.len;
     char kbuf[256];
-    char *key = (klen <= sizeof(kbuf)) ? kbuf : (char *)arena_alloc(cg->arena, klen);
-    if (key) {
-        memcpy(key, cask.data, cask.len);
-        key[cask.len] = '\0';
-        memcpy(key + cask.len + 1, name.data, name.len);
-        size_t idx;
-        if (strmap_get(&cg->fun_map, (Str){key, klen}, &idx)) {
-            return &cg->env->funs[idx];
-        }
+    Str key = strmap_pair_key(kbuf, sizeof(kbuf), cg->arena, cask, name);
+    size_t idx;
+    if (key.data && strmap_get(&cg->env->fun_map, key, &idx)) {
+        return &cg->env->funs[idx];
     }
     return NULL;
 }
 
 static ModuleConsts *codegen_cask_consts(Codegen *cg, Str cask) {
     size_t idx;
-    if (strmap_get(&cg->cask_consts_map, cask, &idx)) {
+    if (strmap_get(&cg->env->cask_consts_map, cask, &idx)) {
         return &cg->env->cask_consts[idx];
     }
     return NULL;
@@ -786,28 +765,24 @@ static ModuleConsts *codegen_cask_consts(Codegen *cg, Str cask) {
 
 static ModuleGlobals *codegen_cask_globals(Codegen *cg, Str cask) {
     size_t idx;
-    if (strmap_get(&cg->cask_globals_map, cask, &idx)) {
+    if (strmap_get(&cg->env->cask_globals_map, cask, &idx)) {
         return &cg->env->cask_globals[idx];
     }
     return NULL;
 }
 
 static GlobalVar *codegen_find_global(ModuleGlobals *mg, Str name) {
-    if (!mg) return NULL;
-    for (size_t i = 0; i < mg->len; i++) {
-        if (str_eq(mg->vars[i].name, name)) {
-            return &mg->vars[i];
-        }
+    size_t idx;
+    if (mg && strmap_get(&mg->index, name, &idx)) {
+        return &mg->vars[idx];
     }
     return NULL;
 }
 
 static ConstEntry *codegen_find_const(ModuleConsts *mc, Str name) {
-    if (!mc) return NULL;
-    for (size_t i = 0; i < mc->len; i++) {
-        if (str_eq(mc->entries[i].name, name)) {
-            return &mc->entries[i];
-        }
+    size_t idx;
+    if (mc && strmap_get(&mc->index, name, &idx)) {
+        return &mc->entries[idx];
     }
     return NULL;
 }
@@ -1158,8 +1133,6 @@ static void collect_stmt(Codegen *cg, Stmt *s, Str path) {
 // Free variable analysis for closures
 // -----------------
 
-typedef VEC(Str) StrVec;
-
 static bool strvec_contains(StrVec *v, Str s) {
     for (size_t i = 0; i < v->len; i++) {
         if (str_eq(v->data[i], s)) return true;
@@ -1167,10 +1140,10 @@ static bool strvec_contains(StrVec *v, Str s) {
     return false;
 }
 
-static void fv_expr(Expr *e, StrVec *defined, StrVec *free_vars);
-static void fv_stmt(Stmt *s, StrVec *defined, StrVec *free_vars);
+static void fv_expr(Expr *e, StrVec *defined, StrVec *free_vars, StrVec *captured);
+static void fv_stmt(Stmt *s, StrVec *defined, StrVec *free_vars, StrVec *captured);
 
-static void fv_expr(Expr *e, StrVec *defined, StrVec *free_vars) {
+static void fv_expr(Expr *e, StrVec *defined, StrVec *free_vars, StrVec *captured) {
     if (!e) return;
     switch (e->kind) {
         case EXPR_IDENT: {
@@ -1185,116 +1158,150 @@ static void fv_expr(Expr *e, StrVec *defined, StrVec *free_vars) {
                 for (size_t i = 0; i < e->as.str_lit.parts->len; i++) {
                     StrPart *p = &e->as.str_lit.parts->parts[i];
                     if (p->kind == STR_PART_EXPR && p->as.expr) {
-                        fv_expr(p->as.expr, defined, free_vars);
+                        fv_expr(p->as.expr, defined, free_vars, captured);
                     }
                 }
             }
             break;
         }
-        case EXPR_UNARY: fv_expr(e->as.unary.x, defined, free_vars); break;
-        case EXPR_BINARY: fv_expr(e->as.binary.a, defined, free_vars); fv_expr(e->as.binary.b, defined, free_vars); break;
-        case EXPR_ASSIGN: fv_expr(e->as.assign.target, defined, free_vars); fv_expr(e->as.assign.value, defined, free_vars); break;
+        case EXPR_UNARY: fv_expr(e->as.unary.x, defined, free_vars, captured); break;
+        case EXPR_BINARY: fv_expr(e->as.binary.a, defined, free_vars, captured); fv_expr(e->as.binary.b, defined, free_vars, captured); break;
+        case EXPR_ASSIGN: fv_expr(e->as.assign.target, defined, free_vars, captured); fv_expr(e->as.assign.value, defined, free_vars, captured); break;
         case EXPR_CALL:
-            fv_expr(e->as.call.fn, defined, free_vars);
-            for (size_t i = 0; i < e->as.call.args_len; i++) fv_expr(e->as.call.args[i], defined, free_vars);
+            fv_expr(e->as.call.fn, defined, free_vars, captured);
+            for (size_t i = 0; i < e->as.call.args_len; i++) fv_expr(e->as.call.args[i], defined, free_vars, captured);
             break;
-        case EXPR_INDEX: fv_expr(e->as.index.a, defined, free_vars); fv_expr(e->as.index.i, defined, free_vars); break;
-        case EXPR_MEMBER: fv_expr(e->as.member.a, defined, free_vars); break;
-        case EXPR_PAREN: fv_expr(e->as.paren.x, defined, free_vars); break;
+        case EXPR_INDEX: fv_expr(e->as.index.a, defined, free_vars, captured); fv_expr(e->as.index.i, defined, free_vars, captured); break;
+        case EXPR_MEMBER: fv_expr(e->as.member.a, defined, free_vars, captured); break;
+        case EXPR_PAREN: fv_expr(e->as.paren.x, defined, free_vars, captured); break;
         case EXPR_MATCH:
-            fv_expr(e->as.match_expr.scrut, defined, free_vars);
+            fv_expr(e->as.match_expr.scrut, defined, free_vars, captured);
             for (size_t i = 0; i < e->as.match_expr.arms_len; i++) {
                 MatchArm *arm = e->as.match_expr.arms[i];
                 if (arm->pat && arm->pat->kind == PAT_IDENT) {
                     VEC_PUSH(*defined, arm->pat->as.name);
                 }
-                fv_expr(arm->expr, defined, free_vars);
+                fv_expr(arm->expr, defined, free_vars, captured);
             }
             break;
         case EXPR_LAMBDA: {
             for (size_t i = 0; i < e->as.lambda.params_len; i++) {
                 VEC_PUSH(*defined, e->as.lambda.params[i]->name);
             }
-            fv_expr(e->as.lambda.body, defined, free_vars);
+            if (captured) {
+                // Record everything this lambda (and any nested lambda) closes over.
+                StrVec lam_defined = {0};
+                StrVec lam_free = {0};
+                for (size_t i = 0; i < e->as.lambda.params_len; i++) {
+                    VEC_PUSH(lam_defined, e->as.lambda.params[i]->name);
+                }
+                fv_expr(e->as.lambda.body, &lam_defined, &lam_free, NULL);
+                for (size_t i = 0; i < lam_free.len; i++) {
+                    if (!strvec_contains(captured, lam_free.data[i])) {
+                        VEC_PUSH(*captured, lam_free.data[i]);
+                    }
+                }
+                free(lam_defined.data);
+                free(lam_free.data);
+            }
+            fv_expr(e->as.lambda.body, defined, free_vars, NULL);
             break;
         }
-        case EXPR_BLOCK: fv_stmt(e->as.block_expr.block, defined, free_vars); break;
+        case EXPR_BLOCK: fv_stmt(e->as.block_expr.block, defined, free_vars, captured); break;
         case EXPR_NEW:
-            for (size_t i = 0; i < e->as.new_expr.args_len; i++) fv_expr(e->as.new_expr.args[i], defined, free_vars);
+            for (size_t i = 0; i < e->as.new_expr.args_len; i++) fv_expr(e->as.new_expr.args[i], defined, free_vars, captured);
             break;
         case EXPR_IF:
             for (size_t i = 0; i < e->as.if_expr.arms_len; i++) {
                 ExprIfArm *arm = e->as.if_expr.arms[i];
-                if (arm->cond) fv_expr(arm->cond, defined, free_vars);
-                fv_expr(arm->value, defined, free_vars);
+                if (arm->cond) fv_expr(arm->cond, defined, free_vars, captured);
+                fv_expr(arm->value, defined, free_vars, captured);
             }
             break;
         case EXPR_TERNARY:
-            fv_expr(e->as.ternary.cond, defined, free_vars);
-            fv_expr(e->as.ternary.then_expr, defined, free_vars);
-            fv_expr(e->as.ternary.else_expr, defined, free_vars);
+            fv_expr(e->as.ternary.cond, defined, free_vars, captured);
+            fv_expr(e->as.ternary.then_expr, defined, free_vars, captured);
+            fv_expr(e->as.ternary.else_expr, defined, free_vars, captured);
             break;
-        case EXPR_MOVE: fv_expr(e->as.move.x, defined, free_vars); break;
+        case EXPR_MOVE: fv_expr(e->as.move.x, defined, free_vars, captured); break;
         case EXPR_TUPLE:
-            for (size_t i = 0; i < e->as.tuple_lit.items_len; i++) fv_expr(e->as.tuple_lit.items[i], defined, free_vars);
+            for (size_t i = 0; i < e->as.tuple_lit.items_len; i++) fv_expr(e->as.tuple_lit.items[i], defined, free_vars, captured);
             break;
         case EXPR_ARRAY:
-            for (size_t i = 0; i < e->as.array_lit.items_len; i++) fv_expr(e->as.array_lit.items[i], defined, free_vars);
+            for (size_t i = 0; i < e->as.array_lit.items_len; i++) fv_expr(e->as.array_lit.items[i], defined, free_vars, captured);
             break;
         case EXPR_DICT:
             for (size_t i = 0; i < e->as.dict_lit.pairs_len; i++) {
-                fv_expr(e->as.dict_lit.keys[i], defined, free_vars);
-                fv_expr(e->as.dict_lit.vals[i], defined, free_vars);
+                fv_expr(e->as.dict_lit.keys[i], defined, free_vars, captured);
+                fv_expr(e->as.dict_lit.vals[i], defined, free_vars, captured);
             }
             break;
         default: break;
     }
 }
 
-static void fv_stmt(Stmt *s, StrVec *defined, StrVec *free_vars) {
+static void fv_stmt(Stmt *s, StrVec *defined, StrVec *free_vars, StrVec *captured) {
     if (!s) return;
     switch (s->kind) {
         case STMT_LET:
-            fv_expr(s->as.let_s.expr, defined, free_vars);
+            fv_expr(s->as.let_s.expr, defined, free_vars, captured);
             VEC_PUSH(*defined, s->as.let_s.name);
             break;
         case STMT_CONST:
-            fv_expr(s->as.const_s.expr, defined, free_vars);
+            fv_expr(s->as.const_s.expr, defined, free_vars, captured);
             VEC_PUSH(*defined, s->as.const_s.name);
             break;
-        case STMT_EXPR: fv_expr(s->as.expr_s.expr, defined, free_vars); break;
-        case STMT_RETURN: fv_expr(s->as.ret_s.expr, defined, free_vars); break;
+        case STMT_EXPR: fv_expr(s->as.expr_s.expr, defined, free_vars, captured); break;
+        case STMT_RETURN: fv_expr(s->as.ret_s.expr, defined, free_vars, captured); break;
         case STMT_IF:
             for (size_t i = 0; i < s->as.if_s.arms_len; i++) {
-                fv_expr(s->as.if_s.arms[i]->cond, defined, free_vars);
-                fv_stmt(s->as.if_s.arms[i]->body, defined, free_vars);
+                fv_expr(s->as.if_s.arms[i]->cond, defined, free_vars, captured);
+                fv_stmt(s->as.if_s.arms[i]->body, defined, free_vars, captured);
             }
             break;
         case STMT_FOR:
-            fv_stmt(s->as.for_s.init, defined, free_vars);
-            fv_expr(s->as.for_s.cond, defined, free_vars);
-            fv_expr(s->as.for_s.step, defined, free_vars);
-            fv_stmt(s->as.for_s.body, defined, free_vars);
+            fv_stmt(s->as.for_s.init, defined, free_vars, captured);
+            fv_expr(s->as.for_s.cond, defined, free_vars, captured);
+            fv_expr(s->as.for_s.step, defined, free_vars, captured);
+            fv_stmt(s->as.for_s.body, defined, free_vars, captured);
             break;
         case STMT_FOREACH:
-            fv_expr(s->as.foreach_s.expr, defined, free_vars);
+            fv_expr(s->as.foreach_s.expr, defined, free_vars, captured);
             VEC_PUSH(*defined, s->as.foreach_s.name);
-            fv_stmt(s->as.foreach_s.body, defined, free_vars);
+            fv_stmt(s->as.foreach_s.body, defined, free_vars, captured);
             break;
         case STMT_BREAK:
         case STMT_CONTINUE:
             break;
         case STMT_BLOCK:
             for (size_t i = 0; i < s->as.block_s.stmts_len; i++) {
-                fv_stmt(s->as.block_s.stmts[i], defined, free_vars);
+                fv_stmt(s->as.block_s.stmts[i], defined, free_vars, captured);
             }
             break;
     }
 }
 
+// Escape analysis for locals: only names some lambda in the body closes
+// over need a shared heap YisRef; everything else stays a plain YisVal.
+static void codegen_scan_captures(Codegen *cg, Stmt *body, Expr *expr) {
+    cg->boxed_names.len = 0;
+    StrVec defined = {0};
+    StrVec free_vars = {0};
+    if (body) fv_stmt(body, &defined, &free_vars, &cg->boxed_names);
+    if (expr) fv_expr(expr, &defined, &free_vars, &cg->boxed_names);
+    free(defined.data);
+    free(free_vars.data);
+}
+
+static bool codegen_is_boxed(Codegen *cg, Str name) {
+    return strvec_contains(&cg->boxed_names, name);
+}
+
 static void codegen_collect_lambdas(Codegen *cg) {
+    if (cg->header_only) return;
     for (size_t i = 0; i < cg->prog->mods_len; i++) {
         Module *m = cg->prog->mods[i];
+        if (!codegen_emits_module(cg, m)) continue;
         for (size_t j = 0; j < m->decls_len; j++) {
             Decl *d = m->decls[j];
             if (d->kind == DECL_FUN) {
@@ -1348,12 +1355,86 @@ static void gen_expr_release_except(Codegen *cg, GenExpr *ge, char *keep) {
     }
 }
 
+// Type of an expression for codegen. typecheck_program has already recorded
+// it on the node; only nodes it never reached (assignment targets, nodes
+// synthesized after checking) are inferred again here.
 static Ty *cg_tc_expr(Codegen *cg, Str path, Expr *e, Diag *err) {
+    if (e && e->ty) return e->ty;
     Ctx ctx = codegen_ctx_for(cg, path);
     Ty *t = tc_expr_ctx(e, &ctx, &cg->ty_loc, cg->env, err);
     return t;
 }
 
+// Best-effort type of an already-checked subexpression, used only to pick a
+// faster emission; NULL (treated as `any`) when it cannot be re-derived.
+static Ty *cg_tc_hint(Codegen *cg, Str path, Expr *e) {
+    Diag scratch = {0};
+    return cg_tc_expr(cg, path, e, &scratch);
+}
+
+static bool cg_ty_is_prim(Ty *t, const char *name) {
+    return t && t->tag == TY_PRIM && str_eq_c(t->name, name);
+}
+
+// C operator for a binary op that has an inline num fast path, or NULL.
+static const char *num_binop_c(TokKind op, bool *is_cmp) {
+    *is_cmp = false;
+    switch (op) {
+        case TOK_PLUS: case TOK_PLUSEQ: return "+";
+        case TOK_MINUS: case TOK_MINUSEQ: return "-";
+        case TOK_STAR: case TOK_STAREQ: return "*";
+        case TOK_SLASH: case TOK_SLASHEQ: return "/";
+        case TOK_PERCENT: case TOK_PERCENTEQ: return "%";
+        default: break;
+    }
+    *is_cmp = true;
+    switch (op) {
+        case TOK_EQEQ: return "==";
+        case TOK_NEQ: return "!=";
+        case TOK_LT: return "<";
+        case TOK_LTE: return "<=";
+        case TOK_GT: return ">";
+        case TOK_GTE: return ">=";
+        default: return NULL;
+    }
+}
+
+// Both operands are statically `num`: int/int and float/float pairs are
+// computed inline on the unboxed payload, and only mixed operands reach the
+// tagged runtime helper `opfn`.
+static char *cg_num_binop(Codegen *cg, TokKind op, const char *opfn, const char *a, const char *b) {
+    bool is_cmp = false;
+    const char *cop = num_binop_c(op, &is_cmp);
+    if (!cop) return arena_printf(cg->arena, "%s(%s, %s)", opfn, a, b);
+    const char *box_i = is_cmp ? "YV_BOOL" : "YV_INT";
+    const char *box_f = is_cmp ? "YV_BOOL" : "YV_FLOAT";
+    if (op == TOK_PERCENT || op == TOK_PERCENTEQ) {
+        return arena_printf(cg->arena, "(%s.tag == EVT_INT && %s.tag == EVT_INT && %s.as.i != 0) ? YV_INT(%s.as.i %% %s.as.i) : %s(%s, %s)",
+                            a, b, b, a, b, opfn, a, b);
+    }
+    if (op == TOK_SLASH || op == TOK_SLASHEQ) {
+        return arena_printf(cg->arena, "(%s.tag == EVT_INT && %s.tag == EVT_INT && %s.as.i != 0) ? YV_INT(%s.as.i / %s.as.i) : "
+                            "(%s.tag == EVT_FLOAT && %s.tag == EVT_FLOAT) ? YV_FLOAT(%s.as.f / %s.as.f) : %s(%s, %s)",
+                            a, b, b, a, b, a, b, a, b, opfn, a, b);
+    }
+    return arena_printf(cg->arena, "(%s.tag == EVT_INT && %s.tag == EVT_INT) ? %s(%s.as.i %s %s.as.i) : "
+                        "(%s.tag == EVT_FLOAT && %s.tag == EVT_FLOAT) ? %s(%s.as.f %s %s.as.f) : %s(%s, %s)",
+                        a, b, box_i, a, cop, b, a, b, box_f, a, cop, b, opfn, a, b);
+}
+
+// Truth test for a condition temp; statically `bool` values read the payload.
+static char *cg_bool_test(Codegen *cg, Ty *ty, const char *v) {
+    if (cg_ty_is_prim(ty, "bool")) {
+        return arena_printf(cg->arena, "(%s.tag == EVT_BOOL ? %s.as.b : yis_as_bool(%s))", v, v, v);
+    }
+    return arena_printf(cg->arena, "yis_as_bool(%s)", v);
+}
+
+// num and bool values carry no heap payload, so their temps need no release.
+static bool cg_ty_is_scalar(Ty *t) {
+    return cg_ty_is_prim(t, "num") || cg_ty_is_prim(t, "bool");
+}
+
 static bool is_assign_op(TokKind op) {
     switch (op) {
         case TOK_EQ:
@@ -1403,7 +1484,7 @@ static bool gen_if_expr_chain(Codegen *cg,
     if (!gen_expr(cg, path, arm->cond, &cond, err)) return false;
     cg->var_id++;
     char *bname = arena_printf(cg->arena, "__b%d", cg->var_id);
-    w_line(&cg->w, "bool %s = yis_as_bool(%s);", bname, cond.tmp);
+    w_line(&cg->w, "bool %s = %s;", bname, cg_bool_test(cg, cg_tc_hint(cg, path, arm->cond), cond.tmp));
     w_line(&cg->w, "yis_release_val(%s);", cond.tmp);
     gen_expr_release_except(cg, &cond, cond.tmp);
     gen_expr_free(&cond);
@@ -1803,7 +1884,7 @@ static bool gen_expr(Codegen *cg, Str path, Expr *e, GenExpr *out, Diag *err) {
             for (size_t p = 0; p < e->as.lambda.params_len; p++) {
                 VEC_PUSH(defined, e->as.lambda.params[p]->name);
             }
-            fv_expr(e->as.lambda.body, &defined, &free_vars);
+            fv_expr(e->as.lambda.body, &defined, &free_vars, NULL);
             // Filter: only capture variables that resolve in current local scope
             size_t cap_count = 0;
             Capture **caps = NULL;
@@ -1991,7 +2072,8 @@ static bool gen_expr(Codegen *cg, Str path, Expr *e, GenExpr *out, Diag *err) {
             if (!gen_expr(cg, path, e->as.unary.x, &ge, err)) return false;
             char *t = codegen_new_tmp(cg);
             if (e->as.unary.op == TOK_BANG) {
-                w_line(&cg->w, "YisVal %s = YV_BOOL(!yis_as_bool(%s));", t, ge.tmp);
+                Ty *xty = cg_tc_hint(cg, path, e->as.unary.x);
+                w_line(&cg->w, "YisVal %s = YV_BOOL(!%s);", t, cg_bool_test(cg, xty, ge.tmp));
             } else if (e->as.unary.op == TOK_MINUS) {
                 Ty *xty = cg_tc_expr(cg, path, e->as.unary.x, err);
                 if (!xty) return false;
@@ -2102,6 +2184,8 @@ static bool gen_expr(Codegen *cg, Str path, Expr *e, GenExpr *out, Diag *err) {
                     // Not a foldable op — fall through to runtime call
                 }
                 // Runtime arithmetic/comparison codegen
+                Ty *aty = cg_tc_hint(cg, path, e->as.binary.a);
+                Ty *bty = cg_tc_hint(cg, path, e->as.binary.b);
                 GenExpr a;
                 GenExpr b;
                 if (!gen_expr(cg, path, e->as.binary.a, &a, err)) return false;
@@ -2127,9 +2211,16 @@ static bool gen_expr(Codegen *cg, Str path, Expr *e, GenExpr *out, Diag *err) {
                     gen_expr_free(&b);
                     return cg_set_err(err, path, "unsupported binary op");
                 }
-                w_line(&cg->w, "YisVal %s = %s(%s, %s);", t, opfn, a.tmp, b.tmp);
-                w_line(&cg->w, "yis_release_val(%s);", a.tmp);
-                w_line(&cg->w, "yis_release_val(%s);", b.tmp);
+                if (cg_ty_is_prim(aty, "num") && cg_ty_is_prim(bty, "num")) {
+                    w_line(&cg->w, "YisVal %s = %s;", t, cg_num_binop(cg, op, opfn, a.tmp, b.tmp));
+                } else if ((op == TOK_EQEQ || op == TOK_NEQ) && cg_ty_is_prim(aty, "bool") && cg_ty_is_prim(bty, "bool")) {
+                    w_line(&cg->w, "YisVal %s = (%s.tag == EVT_BOOL && %s.tag == EVT_BOOL) ? YV_BOOL(%s.as.b %s %s.as.b) : %s(%s, %s);",
+                           t, a.tmp, b.tmp, a.tmp, op == TOK_EQEQ ? "==" : "!=", b.tmp, opfn, a.tmp, b.tmp);
+                } else {
+                    w_line(&cg->w, "YisVal %s = %s(%s, %s);", t, opfn, a.tmp, b.tmp);
+                }
+                if (!cg_ty_is_scalar(aty)) w_line(&cg->w, "yis_release_val(%s);", a.tmp);
+                if (!cg_ty_is_scalar(bty)) w_line(&cg->w, "yis_release_val(%s);", b.tmp);
                 gen_expr_release_except(cg, &a, a.tmp);
                 gen_expr_release_except(cg, &b, b.tmp);
                 gen_expr_free(&a);
@@ -2167,16 +2258,18 @@ static bool gen_expr(Codegen *cg, Str path, Expr *e, GenExpr *out, Diag *err) {
                 return true;
             }
             // logical ops
+            Ty *lty = cg_tc_hint(cg, path, e->as.binary.a);
+            Ty *rty = cg_tc_hint(cg, path, e->as.binary.b);
             GenExpr left;
             if (!gen_expr(cg, path, e->as.binary.a, &left, err)) return false;
             char *t = codegen_new_tmp(cg);
             w_line(&cg->w, "YisVal %s = YV_BOOL(false);", t);
             if (op == TOK_ANDAND) {
-                w_line(&cg->w, "if (yis_as_bool(%s)) {", left.tmp);
+                w_line(&cg->w, "if (%s) {", cg_bool_test(cg, lty, left.tmp));
                 cg->w.indent++;
                 GenExpr right;
                 if (!gen_expr(cg, path, e->as.binary.b, &right, err)) { gen_expr_free(&left); return false; }
-                w_line(&cg->w, "yis_move_into(&%s, YV_BOOL(yis_as_bool(%s)));", t, right.tmp);
+                w_line(&cg->w, "yis_move_into(&%s, YV_BOOL(%s));", t, cg_bool_test(cg, rty, right.tmp));
                 w_line(&cg->w, "yis_release_val(%s);", right.tmp);
                 gen_expr_release_except(cg, &right, right.tmp);
                 gen_expr_free(&right);
@@ -2187,7 +2280,7 @@ static bool gen_expr(Codegen *cg, Str path, Expr *e, GenExpr *out, Diag *err) {
                 cg->w.indent--;
                 w_line(&cg->w, "}");
             } else {
-                w_line(&cg->w, "if (yis_as_bool(%s)) {", left.tmp);
+                w_line(&cg->w, "if (%s) {", cg_bool_test(cg, lty, left.tmp));
                 cg->w.indent++;
                 w_line(&cg->w, "yis_move_into(&%s, YV_BOOL(true));", t);
                 cg->w.indent--;
@@ -2195,7 +2288,7 @@ static bool gen_expr(Codegen *cg, Str path, Expr *e, GenExpr *out, Diag *err) {
                 cg->w.indent++;
                 GenExpr right;
                 if (!gen_expr(cg, path, e->as.binary.b, &right, err)) { gen_expr_free(&left); return false; }
-                w_line(&cg->w, "yis_move_into(&%s, YV_BOOL(yis_as_bool(%s)));", t, right.tmp);
+                w_line(&cg->w, "yis_move_into(&%s, YV_BOOL(%s));", t, cg_bool_test(cg, rty, right.tmp));
                 w_line(&cg->w, "yis_release_val(%s);", right.tmp);
                 gen_expr_release_except(cg, &right, right.tmp);
                 gen_expr_free(&right);
@@ -2344,7 +2437,13 @@ static bool gen_expr(Codegen *cg, Str path, Expr *e, GenExpr *out, Diag *err) {
                         gen_expr_free(&vt);
                         return cg_set_err(err, path, "unknown assignment target");
                     }
-                    w_line(&cg->w, "YisVal %s = %s(%s, %s);", tret, opfn, slot, vt.tmp);
+                    Ty *tty = cg_tc_hint(cg, path, e->as.assign.target);
+                    Ty *vty = cg_tc_hint(cg, path, e->as.assign.value);
+                    if (cg_ty_is_prim(tty, "num") && cg_ty_is_prim(vty, "num")) {
+                        w_line(&cg->w, "YisVal %s = %s;", tret, cg_num_binop(cg, assign_op, opfn, slot, vt.tmp));
+                    } else {
+                        w_line(&cg->w, "YisVal %s = %s(%s, %s);", tret, opfn, slot, vt.tmp);
+                    }
                     w_line(&cg->w, "yis_retain_val(%s);", tret);
                     w_line(&cg->w, "yis_move_into(&%s, %s);", slot, tret);
                 } else if (e->as.assign.target->kind == EXPR_INDEX) {
@@ -3349,7 +3448,7 @@ static bool gen_if_chain(Codegen *cg, Str path, IfArm **arms, size_t idx, size_t
     if (!gen_expr(cg, path, arm->cond, &cond, err)) return false;
     cg->var_id++;
     char *bname = arena_printf(cg->arena, "__b%d", cg->var_id);
-    w_line(&cg->w, "bool %s = yis_as_bool(%s);", bname, cond.tmp);
+    w_line(&cg->w, "bool %s = %s;", bname, cg_bool_test(cg, cg_tc_hint(cg, path, arm->cond), cond.tmp));
     w_line(&cg->w, "yis_release_val(%s);", cond.tmp);
     gen_expr_release_except(cg, &cond, cond.tmp);
     gen_expr_free(&cond);
@@ -3411,11 +3510,8 @@ static bool gen_stmt(Codegen *cg, Str path, Stmt *s, bool ret_void, Diag *err) {
         case STMT_LET: {
             Ty *ty = cg_tc_expr(cg, path, s->as.let_s.expr, err);
             if (!ty) return false;
-            char *cvar = codegen_define_local(cg, s->as.let_s.name, ty, s->as.let_s.is_mut, false);
-            if (!cvar) return cg_set_err(err, path, "out of memory");
-            char *slot = codegen_cname_of(cg, s->as.let_s.name);
-            if (!slot) return cg_set_err(err, path, "missing local slot");
-            w_line(&cg->w, "YisRef* %s = yis_ref_new();", cvar);
+            char *slot = codegen_define_local(cg, s->as.let_s.name, ty, s->as.let_s.is_mut, false);
+            if (!slot) return cg_set_err(err, path, "out of memory");
             GenExpr ge;
             if (!gen_expr(cg, path, s->as.let_s.expr, &ge, err)) return false;
             w_line(&cg->w, "yis_move_into(&%s, %s);", slot, ge.tmp);
@@ -3426,11 +3522,8 @@ static bool gen_stmt(Codegen *cg, Str path, Stmt *s, bool ret_void, Diag *err) {
         case STMT_CONST: {
             Ty *ty = cg_tc_expr(cg, path, s->as.const_s.expr, err);
             if (!ty) return false;
-            char *cvar = codegen_define_local(cg, s->as.const_s.name, ty, false, true);
-            if (!cvar) return cg_set_err(err, path, "out of memory");
-            char *slot = codegen_cname_of(cg, s->as.const_s.name);
-            if (!slot) return cg_set_err(err, path, "missing local slot");
-            w_line(&cg->w, "YisRef* %s = yis_ref_new();", cvar);
+            char *slot = codegen_define_local(cg, s->as.const_s.name, ty, false, true);
+            if (!slot) return cg_set_err(err, path, "out of memory");
             GenExpr ge;
             if (!gen_expr(cg, path, s->as.const_s.expr, &ge, err)) return false;
             w_line(&cg->w, "yis_move_into(&%s, %s);", slot, ge.tmp);
@@ -3502,7 +3595,7 @@ static bool gen_stmt(Codegen *cg, Str path, Stmt *s, bool ret_void, Diag *err) {
                 if (!gen_expr(cg, path, s->as.for_s.cond, &ct, err)) return false;
                 cg->var_id++;
                 char *bname = arena_printf(cg->arena, "__b%d", cg->var_id);
-                w_line(&cg->w, "bool %s = yis_as_bool(%s);", bname, ct.tmp);
+                w_line(&cg->w, "bool %s = %s;", bname, cg_bool_test(cg, cg_tc_hint(cg, path, s->as.for_s.cond), ct.tmp));
                 w_line(&cg->w, "yis_release_val(%s);", ct.tmp);
                 gen_expr_release_except(cg, &ct, ct.tmp);
                 gen_expr_free(&ct);
@@ -3552,7 +3645,7 @@ static bool gen_stmt(Codegen *cg, Str path, Stmt *s, bool ret_void, Diag *err) {
 
             codegen_push_scope(cg);
             char *cvar = codegen_define_local(cg, s->as.foreach_s.name, ety, false, false);
-            w_line(&cg->w, "YisVal %s = YV_NULLV;", cvar);
+            if (!cvar) return cg_set_err(err, path, "out of memory");
 
             w_line(&cg->w, "int %s = stdr_len(%s);", len_name, it.tmp);
             w_line(&cg->w, "for (int %s = 0; %s < %s; %s++) {", idx_name, idx_name, len_name, idx_name);
@@ -3694,19 +3787,17 @@ static bool gen_method(Codegen *cg, Str path, ClassDecl *cls, FunDecl *fn, Diag
     cg->current_class = qname;
     cg->has_current_class = true;
 
+    codegen_scan_captures(cg, fn->body, NULL);
+
     // receiver
     if (fn->params_len > 0) {
-        char *self_ref = arena_printf(cg->arena, "__self_ref");
-        char *self_slot = arena_printf(cg->arena, "%s->val", self_ref);
-        codegen_add_name(cg, fn->params[0]->name, self_slot, self_ref);
-        codegen_add_local(cg, self_ref, true);
         Ty *self_ty = (Ty *)arena_alloc(cg->arena, sizeof(Ty));
         if (!self_ty) return cg_set_err(err, path, "out of memory");
         memset(self_ty, 0, sizeof(Ty));
         self_ty->tag = TY_CLASS;
         self_ty->name = qname;
         Binding b = { self_ty, fn->params[0]->is_mut, false, false };
-        locals_define(&cg->ty_loc, fn->params[0]->name, b);
+        locals_define_hashed(&cg->ty_loc, fn->params[0]->name, str_hash_known(fn->params[0]->name, fn->params[0]->name_hash), b);
     }
 
     ClassInfo *ci = codegen_class_info(cg, qname);
@@ -3723,30 +3814,29 @@ static bool gen_method(Codegen *cg, Str path, ClassDecl *cls, FunDecl *fn, Diag
     // params after this
     for (size_t i = 1; i < fn->params_len; i++) {
         Param *p = fn->params[i];
-        char *arg_ref = arena_printf(cg->arena, "__argref%zu", i - 1);
-        char *arg_slot = arena_printf(cg->arena, "%s->val", arg_ref);
-        codegen_add_name(cg, p->name, arg_slot, arg_ref);
-        codegen_add_local(cg, arg_ref, true);
         Ty *pty = sig ? sig->params[i - 1] : NULL;
         Binding b = { pty, p->is_mut, false, false };
-        locals_define(&cg->ty_loc, p->name, b);
+        locals_define_hashed(&cg->ty_loc, p->name, str_hash_known(p->name, p->name_hash), b);
     }
 
     bool ret_void = fn->ret.is_void;
     const char *ret_ty = ret_void ? "void" : "YisVal";
     char *params = c_params(fn->params_len > 0 ? fn->params_len - 1 : 0, true);
     char *mangled = mangle_method(cg->arena, cg->current_cask, cls->name, fn->name);
-    w_line(&cg->w, "static %s %s(YisVal self%s) {", ret_ty, mangled, params ? params : "");
+    w_line(&cg->w, "%s%s %s(YisVal self%s) {", codegen_linkage(cg), ret_ty, mangled, params ? params : "");
     cg->w.indent++;
 
     if (fn->params_len > 0) {
-        w_line(&cg->w, "YisRef* __self_ref = yis_ref_new();");
-        w_line(&cg->w, "yis_move_into(&__self_ref->val, self);");
+        if (!codegen_bind_param(cg, fn->params[0]->name, "__self_ref", "self")) {
+            return cg_set_err(err, path, "out of memory");
+        }
     }
     for (size_t i = 1; i < fn->params_len; i++) {
         char *arg_ref = arena_printf(cg->arena, "__argref%zu", i - 1);
-        w_line(&cg->w, "YisRef* %s = yis_ref_new();", arg_ref);
-        w_line(&cg->w, "yis_move_into(&%s->val, a%zu);", arg_ref, i - 1);
+        char *arg = arena_printf(cg->arena, "a%zu", i - 1);
+        if (!codegen_bind_param(cg, fn->params[i]->name, arg_ref, arg)) {
+            return cg_set_err(err, path, "out of memory");
+        }
     }
 
     if (!ret_void) {
@@ -3780,29 +3870,28 @@ static bool gen_fun(Codegen *cg, Str path, FunDecl *fn, Diag *err) {
     cg->has_current_class = false;
 
     FunSig *sig = codegen_fun_sig(cg, cg->current_cask, fn->name);
+    codegen_scan_captures(cg, fn->body, NULL);
 
     for (size_t i = 0; i < fn->params_len; i++) {
         Param *p = fn->params[i];
-        char *arg_ref = arena_printf(cg->arena, "__argref%zu", i);
-        char *arg_slot = arena_printf(cg->arena, "%s->val", arg_ref);
-        codegen_add_name(cg, p->name, arg_slot, arg_ref);
-        codegen_add_local(cg, arg_ref, true);
         Ty *pty = sig ? sig->params[i] : NULL;
         Binding b = { pty, p->is_mut, false, false };
-        locals_define(&cg->ty_loc, p->name, b);
+        locals_define_hashed(&cg->ty_loc, p->name, str_hash_known(p->name, p->name_hash), b);
     }
 
     bool ret_void = fn->ret.is_void;
     const char *ret_ty = ret_void ? "void" : "YisVal";
     char *params = c_params(fn->params_len, false);
     char *mangled = mangle_global(cg->arena, cg->current_cask, fn->name);
-    w_line(&cg->w, "static %s %s(%s) {", ret_ty, mangled, params ? params : "void");
+    w_line(&cg->w, "%s%s %s(%s) {", codegen_linkage(cg), ret_ty, mangled, params ? params : "void");
     cg->w.indent++;
 
     for (size_t i = 0; i < fn->params_len; i++) {
         char *arg_ref = arena_printf(cg->arena, "__argref%zu", i);
-        w_line(&cg->w, "YisRef* %s = yis_ref_new();", arg_ref);
-        w_line(&cg->w, "yis_move_into(&%s->val, a%zu);", arg_ref, i);
+        char *arg = arena_printf(cg->arena, "a%zu", i);
+        if (!codegen_bind_param(cg, fn->params[i]->name, arg_ref, arg)) {
+            return cg_set_err(err, path, "out of memory");
+        }
     }
 
     if (!ret_void) {
@@ -3859,6 +3948,7 @@ static bool gen_entry(Codegen *cg, Diag *err) {
         cg->current_imports_len = mi ? mi->imports_len : 0;
     }
 
+    codegen_scan_captures(cg, entry_decl->body, NULL);
     if (entry_decl->body && entry_decl->body->line > 0)
         emit_line_directive(cg, entry_path, entry_decl->body->line);
     w_line(&cg->w, "static void yis_entry(void) {");
@@ -3916,7 +4006,8 @@ static bool gen_exit(Codegen *cg, Diag *err) {
         cg->current_imports_len = mi ? mi->imports_len : 0;
     }
 
-    w_line(&cg->w, "static void yis_exit_fn(void) {");
+    codegen_scan_captures(cg, exit_decl->body, NULL);
+    w_line(&cg->w, "%svoid yis_exit_fn(void) {", codegen_linkage(cg));
     cg->w.indent++;
     if (!gen_block(cg, exit_path, exit_decl->body, true, err)) return false;
     {
@@ -3946,47 +4037,6 @@ static bool codegen_init(Codegen *cg, Program *prog, Arena *arena, Diag *err) {
         return false;
     }
 
-    // Build hash map caches for env lookups
-    if (cg->env->classes_len > 0) {
-        strmap_init(&cg->class_map, arena, cg->env->classes_len);
-        for (size_t i = 0; i < cg->env->classes_len; i++) {
-            strmap_put(&cg->class_map, cg->env->classes[i].qname, i);
-        }
-    }
-    if (cg->env->funs_len > 0) {
-        strmap_init(&cg->fun_map, arena, cg->env->funs_len);
-        for (size_t i = 0; i < cg->env->funs_len; i++) {
-            // Build composite key "cask\0name"
-            FunSig *fs = &cg->env->funs[i];
-            size_t klen = fs->cask.len + 1 + fs->name.len;
-            char *key = (char *)arena_alloc(arena, klen);
-            if (key) {
-                memcpy(key, fs->cask.data, fs->cask.len);
-                key[fs->cask.len] = '\0';
-                memcpy(key + fs->cask.len + 1, fs->name.data, fs->name.len);
-                strmap_put(&cg->fun_map, (Str){key, klen}, i);
-            }
-        }
-    }
-    if (cg->env->cask_globals_len > 0) {
-        strmap_init(&cg->cask_globals_map, arena, cg->env->cask_globals_len);
-        for (size_t i = 0; i < cg->env->cask_globals_len; i++) {
-            strmap_put(&cg->cask_globals_map, cg->env->cask_globals[i].cask, i);
-        }
-    }
-    if (cg->env->cask_consts_len > 0) {
-        strmap_init(&cg->cask_consts_map, arena, cg->env->cask_consts_len);
-        for (size_t i = 0; i < cg->env->cask_consts_len; i++) {
-            strmap_put(&cg->cask_consts_map, cg->env->cask_consts[i].cask, i);
-        }
-    }
-    if (cg->env->cask_imports_len > 0) {
-        strmap_init(&cg->cask_imports_map, arena, cg->env->cask_imports_len);
-        for (size_t i = 0; i < cg->env->cask_imports_len; i++) {
-            strmap_put(&cg->cask_imports_map, cg->env->cask_imports[i].cask, i);
-        }
-    }
-
     // build class decl map
     for (size_t i = 0; i < prog->mods_len; i++) {
         Module *m = prog->mods[i];
@@ -4031,16 +4081,16 @@ static void codegen_free(Codegen *cg) {
     free(cg->scope_locals);
     free(cg->loop_stack);
     free(cg->lambdas);
+    free(cg->boxed_names.data);
     free(cg->funvals);
     free(cg->class_decls);
     locals_free(&cg->ty_loc);
     sb_free(&cg->out);
 }
 
-static bool codegen_gen(Codegen *cg, const char *ext_module_name, const char *ext_bindings_path, Diag *err) {
+// Runtime source plus external module bindings, emitted ahead of the program.
+static bool codegen_emit_prelude(Codegen *cg, const char *ext_module_name, const char *ext_bindings_path, Diag *err) {
     bool has_ext_module = ext_module_name && ext_module_name[0];
-    codegen_collect_lambdas(cg);
-
     const char *runtime_override = getenv("YIS_RUNTIME");
     bool runtime_forced = runtime_override && runtime_override[0];
     const char *runtime_path = runtime_forced ? runtime_override : NULL;
@@ -4145,7 +4195,23 @@ static bool codegen_gen(Codegen *cg, const char *ext_module_name, const char *ex
     }
     arena_free(&tmp_arena);
     free(exe_runtime_path);
-    exe_runtime_path = NULL;
+    return true;
+}
+
+static bool codegen_gen(Codegen *cg, const char *ext_module_name, const char *ext_bindings_path, Diag *err) {
+    Module *exit_mod = codegen_decl_module(cg, DECL_EXIT);
+    bool emits_main = !cg->header_only && codegen_emits_module(cg, codegen_decl_module(cg, DECL_ENTRY));
+    codegen_collect_lambdas(cg);
+
+    if (cg->unit_mod && !emits_main) {
+        sb_append(&cg->out, "#define YIS_RT_EXTERN_STATE 1\n");
+    }
+    if (cg->unit_header) {
+        w_line(&cg->w, "#include \"%s\"", cg->unit_header);
+        w_line(&cg->w, "");
+    } else if (!codegen_emit_prelude(cg, ext_module_name, ext_bindings_path, err)) {
+        return false;
+    }
 
     w_line(&cg->w, "// ---- cask globals ----");
     for (size_t i = 0; i < cg->prog->mods_len; i++) {
@@ -4157,14 +4223,21 @@ static bool codegen_gen(Codegen *cg, const char *ext_module_name, const char *ex
             Decl *d = m->decls[j];
             if (d->kind != DECL_DEF) continue;
             char *gname = mangle_global_var(cg->arena, mod_name, d->as.def_decl.name);
-            w_line(&cg->w, "static YisVal %s = YV_NULLV;", gname);
+            if (cg->header_only) {
+                w_line(&cg->w, "extern YisVal %s;", gname);
+            } else if (codegen_emits_module(cg, m)) {
+                w_line(&cg->w, "%sYisVal %s = YV_NULLV;", codegen_linkage(cg), gname);
+            }
         }
     }
     w_line(&cg->w, "");
 
-    w_line(&cg->w, "// ---- class definitions ----");
-    if (!gen_class_defs(cg, err)) return false;
-    w_line(&cg->w, "");
+    // Split units get class layouts and prototypes from the shared header.
+    if (!cg->unit_mod) {
+        w_line(&cg->w, "// ---- class definitions ----");
+        if (!gen_class_defs(cg, err)) return false;
+        w_line(&cg->w, "");
+    }
 
     if (cg->lambdas_len > 0) {
         w_line(&cg->w, "// ---- lambda forward decls ----");
@@ -4183,7 +4256,7 @@ static bool codegen_gen(Codegen *cg, const char *ext_module_name, const char *ex
     }
 
     w_line(&cg->w, "// ---- forward decls ----");
-    for (size_t i = 0; i < cg->prog->mods_len; i++) {
+    for (size_t i = 0; i < cg->prog->mods_len && !cg->unit_mod; i++) {
         Module *m = cg->prog->mods[i];
         Str mod_name = codegen_cask_name(cg, m->path);
         for (size_t j = 0; j < m->decls_len; j++) {
@@ -4194,7 +4267,7 @@ static bool codegen_gen(Codegen *cg, const char *ext_module_name, const char *ex
                     const char *ret_ty = md->ret.is_void ? "void" : "YisVal";
                     char *params = c_params(md->params_len > 0 ? md->params_len - 1 : 0, true);
                     char *mangled = mangle_method(cg->arena, mod_name, d->as.class_decl.name, md->name);
-                    w_line(&cg->w, "static %s %s(YisVal self%s);", ret_ty, mangled, params ? params : "");
+                    w_line(&cg->w, "%s%s %s(YisVal self%s);", codegen_linkage(cg), ret_ty, mangled, params ? params : "");
                     if (params) free(params);
                 }
             }
@@ -4202,18 +4275,20 @@ static bool codegen_gen(Codegen *cg, const char *ext_module_name, const char *ex
                 const char *ret_ty = d->as.fun.ret.is_void ? "void" : "YisVal";
                 char *params = c_params(d->as.fun.params_len, false);
                 char *mangled = mangle_global(cg->arena, mod_name, d->as.fun.name);
-                w_line(&cg->w, "static %s %s(%s);", ret_ty, mangled, params ? params : "void");
+                w_line(&cg->w, "%s%s %s(%s);", codegen_linkage(cg), ret_ty, mangled, params ? params : "void");
                 if (params) free(params);
             }
         }
         ModuleGlobals *mg = codegen_cask_globals(cg, mod_name);
         if (mg && mg->len > 0) {
             char *init_name = mangle_global_init(cg->arena, mod_name);
-            w_line(&cg->w, "static void %s(void);", init_name);
+            w_line(&cg->w, "%svoid %s(void);", codegen_linkage(cg), init_name);
         }
     }
-    w_line(&cg->w, "static void yis_entry(void);");
+    if (emits_main) w_line(&cg->w, "static void yis_entry(void);");
+    if (cg->header_only && exit_mod) w_line(&cg->w, "void yis_exit_fn(void);");
     w_line(&cg->w, "");
+    if (cg->header_only) return true;
 
     if (cg->funvals_len > 0) {
         w_line(&cg->w, "// ---- function value defs ----");
@@ -4276,9 +4351,9 @@ static bool codegen_gen(Codegen *cg, const char *ext_module_name, const char *ex
         Module *m = cg->prog->mods[i];
         Str mod_name = codegen_cask_name(cg, m->path);
         ModuleGlobals *mg = codegen_cask_globals(cg, mod_name);
-        if (!mg || mg->len == 0) continue;
+        if (!mg || mg->len == 0 || !codegen_emits_module(cg, m)) continue;
         char *init_name = mangle_global_init(cg->arena, mod_name);
-        w_line(&cg->w, "static void %s(void) {", init_name);
+        w_line(&cg->w, "%svoid %s(void) {", codegen_linkage(cg), init_name);
         cg->w.indent++;
         Str saved_mod = cg->current_cask;
         Str *saved_imports = cg->current_imports;
@@ -4292,6 +4367,7 @@ static bool codegen_gen(Codegen *cg, const char *ext_module_name, const char *ex
             Decl *d = m->decls[j];
             if (d->kind != DECL_DEF) continue;
             if (d->line > 0) emit_line_directive(cg, m->path, d->line);
+            codegen_scan_captures(cg, NULL, d->as.def_decl.expr);
             GenExpr ge;
             if (!gen_expr(cg, m->path, d->as.def_decl.expr, &ge, err)) return false;
             char *gname = mangle_global_var(cg->arena, mod_name, d->as.def_decl.name);
@@ -4311,6 +4387,7 @@ static bool codegen_gen(Codegen *cg, const char *ext_module_name, const char *ex
     w_line(&cg->w, "// ---- compiled functions ----");
     for (size_t i = 0; i < cg->prog->mods_len; i++) {
         Module *m = cg->prog->mods[i];
+        if (!codegen_emits_module(cg, m)) continue;
         Str mod_name = codegen_cask_name(cg, m->path);
         cg->current_cask = mod_name;
         ModuleImport *mi = codegen_cask_imports(cg, mod_name);
@@ -4331,11 +4408,16 @@ static bool codegen_gen(Codegen *cg, const char *ext_module_name, const char *ex
         }
     }
 
-    w_line(&cg->w, "// ---- entry ----");
-    if (!gen_entry(cg, err)) return false;
+    if (emits_main) {
+        w_line(&cg->w, "// ---- entry ----");
+        if (!gen_entry(cg, err)) return false;
+    }
 
-    w_line(&cg->w, "// ---- exit ----");
-    if (!gen_exit(cg, err)) return false;
+    if (codegen_emits_module(cg, exit_mod)) {
+        w_line(&cg->w, "// ---- exit ----");
+        if (!gen_exit(cg, err)) return false;
+    }
+    cg->has_exit = exit_mod != NULL;
 
     // ---- deferred lambda bodies ----
     // Generated AFTER functions/methods/entry so captures are populated
@@ -4396,14 +4478,14 @@ static bool codegen_gen(Codegen *cg, const char *ext_module_name, const char *ex
         }
 
         w_line(&cg->w, "if (argc != %zu) yis_trap(\"lambda arity mismatch\");", li->lam->as.lambda.params_len);
+        codegen_scan_captures(cg, NULL, li->lam->as.lambda.body);
         for (size_t p = 0; p < li->lam->as.lambda.params_len; p++) {
             Param *param = li->lam->as.lambda.params[p];
             char *rname = arena_printf(cg->arena, "__argref%zu", p);
-            char *slot = arena_printf(cg->arena, "%s->val", rname);
-            w_line(&cg->w, "YisRef* %s = yis_ref_new();", rname);
-            w_line(&cg->w, "yis_move_into(&%s, argv[%zu]);", slot, p);
-            codegen_add_name(cg, param->name, slot, rname);
-            codegen_add_local(cg, rname, true);
+            char *arg = arena_printf(cg->arena, "argv[%zu]", p);
+            if (!codegen_bind_param(cg, param->name, rname, arg)) {
+                return cg_set_err(err, li->path, "out of memory");
+            }
             Ty *pty = NULL;
             if (param->typ) {
                 pty = cg_ty_from_type_ref(cg, param->typ, cg->current_cask, cg->current_imports, cg->current_imports_len, err);
@@ -4411,7 +4493,7 @@ static bool codegen_gen(Codegen *cg, const char *ext_module_name, const char *ex
                 pty = cg_ty_gen(cg, param->name);
             }
             Binding b = { pty, param->is_mut, false, false };
-            locals_define(&cg->ty_loc, param->name, b);
+            locals_define_hashed(&cg->ty_loc, param->name, str_hash_known(param->name, param->name_hash), b);
         }
         w_line(&cg->w, "YisVal __ret = YV_NULLV;");
         GenExpr ge;
@@ -4456,6 +4538,7 @@ static bool codegen_gen(Codegen *cg, const char *ext_module_name, const char *ex
         cg->w.indent = saved_indent;
     }
     w_line(&cg->w, "");
+    if (!emits_main) return true;
 
     w_line(&cg->w, "int main(int argc, char **argv) {");
     cg->w.indent++;
@@ -4508,3 +4591,85 @@ bool emit_c(Program *prog, const char *out_path,
     arena_free(&arena);
     return true;
 }
+
+bool emit_c_header(Program *prog, CUnit *out, Diag *err) {
+    if (!prog || !out) {
+        return cg_set_err(err, (Str){NULL, 0}, "emit_c_header: missing program or output");
+    }
+    Arena arena;
+    arena_init(&arena);
+    Codegen cg;
+    if (!codegen_init(&cg, prog, &arena, err)) {
+        arena_free(&arena);
+        return false;
+    }
+    cg.header_only = true;
+    if (!codegen_gen(&cg, NULL, NULL, err)) {
+        codegen_free(&cg);
+        arena_free(&arena);
+        return false;
+    }
+    out->name = dup_cstr("yis_units");
+    out->text = cg.out.data;
+    out->len = cg.out.len;
+    cg.out.data = NULL;
+    codegen_free(&cg);
+    arena_free(&arena);
+    if (!out->name) {
+        free(out->text);
+        out->text = NULL;
+        return cg_set_err(err, (Str){NULL, 0}, "out of memory");
+    }
+    return true;
+}
+
+bool emit_c_units(Program *prog, const char *header_name, CUnit **out_units, size_t *out_len, Diag *err) {
+    if (!prog || !header_name || !out_units || !out_len) {
+        return cg_set_err(err, (Str){NULL, 0}, "emit_c_units: missing program or output");
+    }
+    CUnit *units = (CUnit *)calloc(prog->mods_len ? prog->mods_len : 1, sizeof(CUnit));
+    if (!units) return cg_set_err(err, (Str){NULL, 0}, "out of memory");
+    for (size_t i = 0; i < prog->mods_len; i++) {
+        // A fresh generator per unit keeps temp/lambda numbering local to the
+        // module, so a unit's text only changes when it or an interface does.
+        Arena arena;
+        arena_init(&arena);
+        Codegen cg;
+        if (!codegen_init(&cg, prog, &arena, err)) {
+            arena_free(&arena);
+            c_units_free(units, i);
+            return false;
+        }
+        cg.unit_mod = prog->mods[i];
+        cg.unit_header = header_name;
+        if (!codegen_gen(&cg, NULL, NULL, err)) {
+            codegen_free(&cg);
+            arena_free(&arena);
+            c_units_free(units, i);
+            return false;
+        }
+        Str mod_name = codegen_cask_name(&cg, prog->mods[i]->path);
+        char *name = mangle_mod(&arena, mod_name);
+        units[i].name = dup_cstr(name && name[0] ? name : "main");
+        units[i].text = cg.out.data;
+        units[i].len = cg.out.len;
+        cg.out.data = NULL;
+        codegen_free(&cg);
+        arena_free(&arena);
+        if (!units[i].name) {
+            c_units_free(units, i + 1);
+            return cg_set_err(err, (Str){NULL, 0}, "out of memory");
+        }
+    }
+    *out_units = units;
+    *out_len = prog->mods_len;
+    return true;
+}
+
+void c_units_free(CUnit *units, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        free(units[i].name);
+        free(units[i].text);
+    }
+    free(units);
+}
@@ -13,4 +13,21 @@ bool emit_c(Program *prog, const char *out_path,
             const char *ext_module_name, const char *ext_bindings_path,
             Diag *err);
 
+// One generated C translation unit of a split build.
+typedef struct {
+    char *name;  // cask name, safe for use in file names
+    char *text;
+    size_t len;
+} CUnit;
+
+// Split build. emit_c_header generates the header shared by all units: the
+// runtime, class layouts, cask global declarations and every prototype.
+// emit_c_units then generates one translation unit per module of prog that
+// includes that header as header_name. Only the unit of the module holding
+// entry() defines main(). Programs that use an external module must go
+// through emit_c instead.
+bool emit_c_header(Program *prog, CUnit *out, Diag *err);
+bool emit_c_units(Program *prog, const char *header_name, CUnit **out_units, size_t *out_len, Diag *err);
+void c_units_free(CUnit *units, size_t len);
+
 #endif
@@ -11,6 +11,8 @@
 #include <sys/stat.h>
 #define stat _stat
 #else
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #endif
@@ -28,10 +30,63 @@ static char *strdup_or_null(const char *s) {
     return out;
 }
 
+#if !defined(_WIN32)
+static void unmap_file(void *base, size_t span) {
+    munmap(base, span);
+}
+
+// Maps a regular file read-only for the arena's lifetime. The mapping sits in
+// a reserved span with at least one zero byte after the data, so callers get
+// the same NUL-terminated buffer a read would give. Returns NULL when the
+// file cannot be mapped (empty, not regular, mmap failure); callers then fall
+// back to reading it.
+static char *map_file_arena(const char *path, Arena *arena, size_t *out_len) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t len = (size_t)st.st_size;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t span = (len / page + 1) * page;
+    void *base = mmap(NULL, span, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if (mmap(base, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, span);
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    if (!arena_on_free(arena, unmap_file, base, span)) {
+        munmap(base, span);
+        return NULL;
+    }
+    *out_len = len;
+    return (char *)base;
+}
+#endif
+
 char *read_file_arena(const char *path, Arena *arena, size_t *out_len, Diag *err) {
     if (!path || !arena) {
         return NULL;
     }
+#if !defined(_WIN32)
+    size_t mapped_len = 0;
+    char *mapped = map_file_arena(path, arena, &mapped_len);
+    if (mapped) {
+        if (out_len) {
+            *out_len = mapped_len;
+        }
+        return mapped;
+    }
+#endif
     FILE *f = fopen(path, "rb");
     if (!f) {
         if (err) {
@@ -353,10 +408,39 @@ static bool read_file_with_includes_rec(const char *path, const char *directive,
     return true;
 }
 
+static bool contains_bytes(const char *hay, size_t len, const char *needle) {
+    size_t nlen = strlen(needle);
+    if (nlen == 0 || nlen > len) {
+        return nlen == 0;
+    }
+    const char *p = hay;
+    const char *end = hay + len - nlen + 1;
+    while (p < end && (p = (const char *)memchr(p, needle[0], (size_t)(end - p))) != NULL) {
+        if (memcmp(p, needle, nlen) == 0) {
+            return true;
+        }
+        p++;
+    }
+    return false;
+}
+
 char *read_file_with_includes(const char *path, const char *directive, Arena *arena, size_t *out_len, Diag *err) {
     if (!path || !arena || !directive) {
         return NULL;
     }
+    // Most sources have no includes: hand back the file itself (mapped where
+    // possible) instead of copying it through the splice buffer.
+    size_t src_len = 0;
+    char *src = read_file_arena(path, arena, &src_len, err);
+    if (!src) {
+        return NULL;
+    }
+    if (!contains_bytes(src, src_len, directive)) {
+        if (out_len) {
+            *out_len = src_len;
+        }
+        return src;
+    }
     char *out = NULL;
     size_t len = 0;
     size_t cap = 0;
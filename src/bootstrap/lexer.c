@@ -9,13 +9,21 @@
 #include <string.h>
 #include <stdarg.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 typedef struct {
     const char *path;
     const char *src;
     size_t len;
     size_t i;
+    // line/col describe offset `i` only after lex_sync(); they are derived
+    // lazily from the newlines between sync_i and i.
     int line;
     int col;
+    size_t sync_i;
+    size_t line_start;
     int nest;
     int ret_depth;
     TokKind last_real;
@@ -213,6 +221,102 @@ const char *tok_kind_desc(TokKind kind) {
     }
 }
 
+// Character classes for the byte-at-a-time paths. Bytes >= 0x80 are all 0.
+enum {
+    CC_SPACE = 0x01,        // ' ', '\t', '\r'
+    CC_IDENT_START = 0x02,  // [A-Za-z_]
+    CC_IDENT = 0x04,        // [A-Za-z0-9_]
+    CC_DIGIT = 0x08,        // [0-9]
+    CC_HEX_UPPER = 0x10     // [A-F], may begin a bare hex literal
+};
+
+static const unsigned char k_char_class[256] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,  // 0x00
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // 0x10
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // 0x20
+    0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // 0x30
+    0x00, 0x16, 0x16, 0x16, 0x16, 0x16, 0x16, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,  // 0x40
+    0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x00, 0x00, 0x00, 0x00, 0x06,  // 0x50
+    0x00, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,  // 0x60
+    0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00,  // 0x70
+};
+
+static inline unsigned char char_class(char ch) {
+    return k_char_class[(unsigned char)ch];
+}
+
+// Brings line/col up to date with the current offset. Offsets only move
+// forward, so each byte is scanned for newlines at most once, via memchr.
+// Columns keep the historical numbering: 0-based on the first line, 1-based
+// after a newline.
+static void lex_sync(Lexer *lx) {
+    const char *p = lx->src + lx->sync_i;
+    const char *end = lx->src + lx->i;
+    while (p < end) {
+        const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+        if (!nl) break;
+        lx->line += 1;
+        lx->line_start = (size_t)(nl - lx->src) + 1;
+        p = nl + 1;
+    }
+    lx->sync_i = lx->i;
+    lx->col = (int)(lx->i - lx->line_start) + (lx->line == 1 ? 0 : 1);
+}
+
+// Offset of the first byte at or after i that is not ' ', '\t' or '\r'.
+// Indentation is long runs of spaces, so those go 16 (or 8) bytes at a time.
+static size_t skip_blanks(const char *s, size_t i, size_t len) {
+#if defined(__SSE2__)
+    const __m128i sp = _mm_set1_epi8(' ');
+    while (i + 16 <= len) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, sp)) ^ 0xFFFFu;
+        if (mask) {
+            i += (size_t)__builtin_ctz(mask);
+            break;
+        }
+        i += 16;
+    }
+#else
+    while (i + 8 <= len) {
+        uint64_t w;
+        memcpy(&w, s + i, 8);
+        if (w != 0x2020202020202020ull) break;
+        i += 8;
+    }
+#endif
+    while (i < len && (char_class(s[i]) & CC_SPACE)) i++;
+    return i;
+}
+
+// Offset of the first '-' or '|' at or after i (len if none): the only
+// bytes that can open or close a block comment.
+static size_t find_block_comment_mark(const char *s, size_t i, size_t len) {
+#if defined(__SSE2__)
+    const __m128i dash = _mm_set1_epi8('-');
+    const __m128i bar = _mm_set1_epi8('|');
+    while (i + 16 <= len) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, dash), _mm_cmpeq_epi8(v, bar)));
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+        i += 16;
+    }
+#else
+    const uint64_t lo = 0x0101010101010101ull;
+    const uint64_t hi = 0x8080808080808080ull;
+    while (i + 8 <= len) {
+        uint64_t w;
+        memcpy(&w, s + i, 8);
+        uint64_t d = w ^ (lo * (unsigned char)'-');
+        uint64_t b = w ^ (lo * (unsigned char)'|');
+        if (((d - lo) & ~d & hi) | ((b - lo) & ~b & hi)) break;
+        i += 8;
+    }
+#endif
+    while (i < len && s[i] != '-' && s[i] != '|') i++;
+    return i;
+}
+
 static char peek(Lexer *lx, size_t k) {
     size_t idx = lx->i + k;
     if (idx >= lx->len) {
@@ -222,26 +326,15 @@ static char peek(Lexer *lx, size_t k) {
 }
 
 static void adv(Lexer *lx, size_t n) {
-    for (size_t k = 0; k < n; k++) {
-        if (lx->i >= lx->len) {
-            return;
-        }
-        char ch = lx->src[lx->i++];
-        if (ch == '\n') {
-            lx->line += 1;
-            lx->col = 1;
-        } else {
-            lx->col += 1;
-        }
-    }
+    lx->i = (n < lx->len - lx->i) ? lx->i + n : lx->len;
 }
 
 static bool is_ident_start(char ch) {
-    return isalpha((unsigned char)ch) || ch == '_';
+    return (char_class(ch) & CC_IDENT_START) != 0;
 }
 
 static bool is_ident_mid(char ch) {
-    return isalnum((unsigned char)ch) || ch == '_';
+    return (char_class(ch) & CC_IDENT) != 0;
 }
 
 // str_from_slice is now in str.h
@@ -278,6 +371,7 @@ static bool tokvec_push(TokVec *vec, Tok tok, Diag *err, Lexer *lx) {
         Tok *new_data = (Tok *)realloc(vec->data, next * sizeof(Tok));
         if (!new_data) {
             if (err) {
+                lex_sync(lx);
                 err->path = lx->path;
                 err->line = lx->line;
                 err->col = lx->col;
@@ -301,6 +395,7 @@ static bool charvec_push(CharVec *vec, char c, Diag *err, Lexer *lx) {
         char *new_data = (char *)realloc(vec->data, next);
         if (!new_data) {
             if (err) {
+                lex_sync(lx);
                 err->path = lx->path;
                 err->line = lx->line;
                 err->col = lx->col;
@@ -331,6 +426,7 @@ static bool strpartvec_push(StrPartVec *vec, StrPart part, Diag *err, Lexer *lx)
         StrPart *new_data = (StrPart *)realloc(vec->data, next * sizeof(StrPart));
         if (!new_data) {
             if (err) {
+                lex_sync(lx);
                 err->path = lx->path;
                 err->line = lx->line;
                 err->col = lx->col;
@@ -439,12 +535,23 @@ static bool emit_simple(Lexer *lx, TokVec *out, Diag *err, TokKind kind, Str tex
     return emit_tok(lx, out, err, kind, text, line, col, NULL);
 }
 
-static bool emit_ident(Lexer *lx, TokVec *out, Diag *err, Str text, int line, int col) {
+// Emits a fixed operator token at the current position and steps over it.
+static bool emit_op(Lexer *lx, TokVec *out, Diag *err, TokKind kind, Str text, size_t n) {
+    if (!emit_simple(lx, out, err, kind, text, lx->line, lx->col)) {
+        return false;
+    }
+    adv(lx, n);
+    set_last(lx, kind);
+    return true;
+}
+
+static bool emit_ident(Lexer *lx, TokVec *out, Diag *err, Str text, uint32_t hash, int line, int col) {
     Tok t;
     if (!emit_tok(lx, out, err, TOK_IDENT, text, line, col, &t)) {
         return false;
     }
     out->data[out->len - 1].val.ident = text;
+    out->data[out->len - 1].hash = hash;
     return true;
 }
 
@@ -644,6 +751,73 @@ static bool append_octal_escape(Lexer *lx, CharVec *buf, Diag *err, int line, in
     return append_utf8(buf, (uint32_t)value, err, lx);
 }
 
+// Keyword table indexed by bits 24..29 of the FNV-1a hash (str_hash), which
+// is collision-free over the keyword set, so a word classifies with a single
+// probe. Regenerate the slots when adding a keyword.
+#define KW_SLOT(h) (((h) >> 24) & 63u)
+
+typedef struct {
+    const char *text;
+    unsigned char len;
+    TokKind kind;
+} KwSlot;
+
+static const KwSlot k_kw_slots[64] = {
+    [0] = { "elif", 4, TOK_KW_elif },
+    [1] = { "in", 2, TOK_KW_in },
+    [5] = { "def", 3, TOK_KW_def },
+    [9] = { "break", 5, TOK_KW_break },
+    [11] = { "false", 5, TOK_KW_false },
+    [13] = { "true", 4, TOK_KW_true },
+    [16] = { "let", 3, TOK_KW_let },
+    [21] = { "cask", 4, TOK_KW_cask },
+    [24] = { "seal", 4, TOK_KW_seal },
+    [27] = { "pub", 3, TOK_KW_pub },
+    [38] = { "const", 5, TOK_KW_const },
+    [40] = { "new", 3, TOK_KW_new },
+    [43] = { "class", 5, TOK_KW_class },
+    [44] = { "for", 3, TOK_KW_for },
+    [47] = { "lock", 4, TOK_KW_lock },
+    [48] = { "bring", 5, TOK_KW_bring },
+    [49] = { "continue", 8, TOK_KW_continue },
+    [55] = { "null", 4, TOK_KW_null },
+    [57] = { "if", 2, TOK_KW_if },
+    [61] = { "else", 4, TOK_KW_else },
+    [62] = { "match", 5, TOK_KW_match },
+};
+
+// Scans an identifier or keyword starting at lx->i; line/col must be synced.
+// The word is hashed as it is scanned; the same hash picks the keyword slot
+// and is kept on identifier tokens.
+static bool lex_word(Lexer *lx, TokVec *out, Diag *err) {
+    int start_line = lx->line;
+    int start_col = lx->col;
+    size_t start = lx->i;
+    const char *s = lx->src;
+    uint32_t h = (2166136261u ^ (uint8_t)s[start]) * 16777619u;
+    size_t i = start + 1;
+    while (i < lx->len && (char_class(s[i]) & CC_IDENT)) {
+        h = (h ^ (uint8_t)s[i]) * 16777619u;
+        i++;
+    }
+    lx->i = i;
+    Str word = str_from_slice(s + start, i - start);
+
+    const KwSlot *kw = &k_kw_slots[KW_SLOT(h)];
+    if (kw->len == word.len && memcmp(kw->text, word.data, word.len) == 0) {
+        if (!emit_simple(lx, out, err, kw->kind, word, start_line, start_col)) {
+            return false;
+        }
+        set_last(lx, kw->kind);
+    } else {
+        if (!emit_ident(lx, out, err, word, h, start_line, start_col)) {
+            return false;
+        }
+        set_last(lx, TOK_IDENT);
+    }
+    return true;
+}
+
 bool lex_source(const char *path, const char *src, size_t len, Arena *arena, TokVec *out, Diag *err) {
     if (!out) {
         return false;
@@ -651,6 +825,9 @@ bool lex_source(const char *path, const char *src, size_t len, Arena *arena, Tok
     out->data = NULL;
     out->len = 0;
     out->cap = 0;
+    // Source averages about four bytes per token; reserving up front avoids
+    // the doubling copies on large files.
+    vec_reserve_impl((void **)&out->data, &out->cap, sizeof(Tok), len / 4 + 64);
 
     Lexer lx;
     lx.path = path ? path : "";
@@ -659,6 +836,8 @@ bool lex_source(const char *path, const char *src, size_t len, Arena *arena, Tok
     lx.i = 0;
     lx.line = 1;
     lx.col = 0;
+    lx.sync_i = 0;
+    lx.line_start = 0;
     lx.nest = 0;
     lx.ret_depth = 0;
     lx.last_real = TOK_INVALID;
@@ -666,284 +845,218 @@ bool lex_source(const char *path, const char *src, size_t len, Arena *arena, Tok
     lx.arena = arena;
 
     while (lx.i < lx.len) {
+        lx.i = skip_blanks(lx.src, lx.i, lx.len);
+        if (lx.i >= lx.len) {
+            break;
+        }
+        lex_sync(&lx);
         char ch = peek(&lx, 0);
-        char two0 = ch;
         char two1 = peek(&lx, 1);
 
-        if (ch == ' ' || ch == '\t' || ch == '\r') {
-            adv(&lx, 1);
+        // Identifiers and keywords are most tokens. Unless the first byte
+        // could start a bare hex literal (A-F), none of the punctuation
+        // checks below can match, so go straight to the word scanner.
+        unsigned char cls = char_class(ch);
+        if ((cls & CC_IDENT_START) && !(cls & CC_HEX_UPPER)) {
+            if (!lex_word(&lx, out, err)) {
+                return false;
+            }
             continue;
         }
 
         if (ch == '\n') {
-            adv(&lx, 1);
             if (lx.nest == 0 && is_stmt_end(lx.last_sig)) {
-                if (!emit_simple(&lx, out, err, TOK_NEWLINE_SEMI, STR_LIT(";"), lx.line - 1, 0)) {
+                if (!emit_simple(&lx, out, err, TOK_NEWLINE_SEMI, STR_LIT(";"), lx.line, 0)) {
                     return false;
                 }
                 lx.last_real = TOK_NEWLINE_SEMI;
             }
+            adv(&lx, 1);
             continue;
         }
 
-        if (two0 == '(' && two1 == '(' && lx.ret_depth == 0 && lx.last_sig == TOK_RPAR) {
-            if (!emit_simple(&lx, out, err, TOK_RET_L, STR_LIT("(("), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            lx.ret_depth += 1;
-            set_last(&lx, TOK_RET_L);
-            continue;
-        }
-
-        if (two0 == ')' && two1 == ')' && lx.ret_depth > 0) {
-            if (!emit_simple(&lx, out, err, TOK_RET_R, STR_LIT("))"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            if (lx.ret_depth > 0) {
-                lx.ret_depth -= 1;
-            }
-            set_last(&lx, TOK_RET_R);
-            continue;
-        }
-
-        // Block comment: -| ... |- (nestable)
-        if (two0 == '-' && two1 == '|') {
-            int bc_line = lx.line;
-            int bc_col = lx.col;
-            adv(&lx, 2); // skip -|
-            int depth = 1;
-            while (lx.i < lx.len && depth > 0) {
-                char c0 = peek(&lx, 0);
-                char c1 = (lx.i + 1 < lx.len) ? peek(&lx, 1) : '\0';
-                if (c0 == '-' && c1 == '|') {
-                    depth++;
-                    adv(&lx, 2);
-                } else if (c0 == '|' && c1 == '-') {
-                    depth--;
-                    adv(&lx, 2);
+        // Operators that depend on the next byte, dispatched on the first.
+        switch (ch) {
+            case '(':
+                if (two1 == '(' && lx.ret_depth == 0 && lx.last_sig == TOK_RPAR) {
+                    if (!emit_op(&lx, out, err, TOK_RET_L, STR_LIT("(("), 2)) return false;
+                    lx.ret_depth += 1;
+                    continue;
+                }
+                break;
+            case ')':
+                if (two1 == ')' && lx.ret_depth > 0) {
+                    if (!emit_op(&lx, out, err, TOK_RET_R, STR_LIT("))"), 2)) return false;
+                    lx.ret_depth -= 1;
+                    continue;
+                }
+                break;
+            case '-':
+                // Block comment: -| ... |- (nestable)
+                if (two1 == '|') {
+                    int bc_line = lx.line;
+                    int bc_col = lx.col;
+                    adv(&lx, 2); // skip -|
+                    int depth = 1;
+                    while (lx.i < lx.len && depth > 0) {
+                        lx.i = find_block_comment_mark(lx.src, lx.i, lx.len);
+                        if (lx.i >= lx.len) {
+                            break;
+                        }
+                        char c0 = peek(&lx, 0);
+                        char c1 = (lx.i + 1 < lx.len) ? peek(&lx, 1) : '\0';
+                        if (c0 == '-' && c1 == '|') {
+                            depth++;
+                            adv(&lx, 2);
+                        } else if (c0 == '|' && c1 == '-') {
+                            depth--;
+                            adv(&lx, 2);
+                        } else {
+                            adv(&lx, 1);
+                        }
+                    }
+                    if (depth > 0) {
+                        return set_error(&lx, err, bc_line, bc_col, "unterminated block comment");
+                    }
+                    continue;
+                }
+                if (two1 == '>') {
+                    TokKind kind = lx.ret_depth > 0 ? TOK_RET_VECTOR : TOK_ARROW_RIGHT;
+                    if (!emit_op(&lx, out, err, kind, STR_LIT("->"), 2)) return false;
+                    continue;
+                }
+                if (two1 == '-' && lx.ret_depth > 0) {
+                    if (!emit_op(&lx, out, err, TOK_RET_VOID, STR_LIT("--"), 2)) return false;
+                    continue;
+                }
+                if (two1 == '-') {
+                    const char *nl = (const char *)memchr(lx.src + lx.i, '\n', lx.len - lx.i);
+                    lx.i = nl ? (size_t)(nl - lx.src) : lx.len;
+                    continue;
+                }
+                if (two1 == '=') {
+                    if (!emit_op(&lx, out, err, TOK_MINUSEQ, STR_LIT("-="), 2)) return false;
+                    continue;
+                }
+                break;
+            case '=':
+                if (two1 == '=') {
+                    if (!emit_op(&lx, out, err, TOK_EQEQ, STR_LIT("=="), 2)) return false;
+                    continue;
+                }
+                if (two1 == ':') {
+                    if (!emit_op(&lx, out, err, TOK_EQ_COLON, STR_LIT("=:"), 2)) return false;
+                    continue;
+                }
+                if (two1 == '>') {
+                    if (!emit_op(&lx, out, err, TOK_ARROW, STR_LIT("=>"), 2)) return false;
+                    continue;
+                }
+                break;
+            case '!':
+                if (two1 == '=') {
+                    if (!emit_op(&lx, out, err, TOK_NEQ, STR_LIT("!="), 2)) return false;
+                    continue;
+                }
+                if (two1 == ':') {
+                    if (!emit_op(&lx, out, err, TOK_BANG_COLON, STR_LIT("!:"), 2)) return false;
+                    continue;
+                }
+                break;
+            case '<':
+                if (two1 == '=') {
+                    if (!emit_op(&lx, out, err, TOK_LTE, STR_LIT("<="), 2)) return false;
+                    continue;
+                }
+                if (two1 == '-') {
+                    if (!emit_op(&lx, out, err, TOK_ARROW_LEFT, STR_LIT("<-"), 2)) return false;
+                    continue;
+                }
+                break;
+            case '>':
+                if (two1 == '=') {
+                    if (!emit_op(&lx, out, err, TOK_GTE, STR_LIT(">="), 2)) return false;
+                    continue;
+                }
+                break;
+            case '&':
+                if (two1 == '&') {
+                    if (!emit_op(&lx, out, err, TOK_ANDAND, STR_LIT("&&"), 2)) return false;
+                    continue;
+                }
+                break;
+            case '|':
+                if (two1 == '|') {
+                    if (!emit_op(&lx, out, err, TOK_OROR, STR_LIT("||"), 2)) return false;
+                    continue;
+                }
+                if (two1 == ':') {
+                    if (!emit_op(&lx, out, err, TOK_BAR_COLON, STR_LIT("|:"), 2)) return false;
+                    continue;
+                }
+                break;
+            case '+':
+                if (two1 == '=') {
+                    if (!emit_op(&lx, out, err, TOK_PLUSEQ, STR_LIT("+="), 2)) return false;
+                    continue;
+                }
+                break;
+            case '*':
+                if (two1 == '=') {
+                    if (!emit_op(&lx, out, err, TOK_STAREQ, STR_LIT("*="), 2)) return false;
+                    continue;
+                }
+                break;
+            case '/':
+                if (two1 == '=') {
+                    if (!emit_op(&lx, out, err, TOK_SLASHEQ, STR_LIT("/="), 2)) return false;
+                    continue;
+                }
+                break;
+            case '%':
+                if (two1 == '=') {
+                    if (!emit_op(&lx, out, err, TOK_PERCENTEQ, STR_LIT("%="), 2)) return false;
+                    continue;
+                }
+                break;
+            case '?':
+                if (two1 == '?') {
+                    if (!emit_op(&lx, out, err, TOK_QQ, STR_LIT("??"), 2)) return false;
                 } else {
-                    adv(&lx, 1);
+                    if (!emit_op(&lx, out, err, TOK_QMARK, STR_LIT("?"), 1)) return false;
+                }
+                continue;
+            case ',':
+                if (two1 == ':') {
+                    if (!emit_op(&lx, out, err, TOK_COMMA_COLON, STR_LIT(",:"), 2)) return false;
+                    continue;
+                }
+                break;
+            case '.':
+                if (two1 == ':') {
+                    if (!emit_op(&lx, out, err, TOK_DOTCOLON, STR_LIT(".:"), 2)) return false;
+                    continue;
+                }
+                break;
+            case ':':
+                if (two1 == ':') {
+                    if (!emit_op(&lx, out, err, TOK_COLONCOLON, STR_LIT("::"), 2)) return false;
+                } else {
+                    if (!emit_op(&lx, out, err, TOK_COLON, STR_LIT(":"), 1)) return false;
+                }
+                continue;
+            case ';':
+                if (!emit_simple(&lx, out, err, TOK_SEMI, STR_LIT(";"), lx.line, lx.col)) {
+                    return false;
                 }
-            }
-            if (depth > 0) {
-                return set_error(&lx, err, bc_line, bc_col, "unterminated block comment");
-            }
-            continue;
-        }
-
-        if (two0 == '-' && two1 == '>' && lx.ret_depth > 0) {
-            if (!emit_simple(&lx, out, err, TOK_RET_VECTOR, STR_LIT("->"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_RET_VECTOR);
-            continue;
-        }
-
-        if (two0 == '-' && two1 == '>' && lx.ret_depth == 0) {
-            if (!emit_simple(&lx, out, err, TOK_ARROW_RIGHT, STR_LIT("->"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_ARROW_RIGHT);
-            continue;
-        }
-
-        if (two0 == '-' && two1 == '-' && lx.ret_depth > 0) {
-            if (!emit_simple(&lx, out, err, TOK_RET_VOID, STR_LIT("--"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_RET_VOID);
-            continue;
-        }
-
-        if (two0 == '-' && two1 == '-' && lx.ret_depth == 0) {
-            adv(&lx, 2);
-            while (lx.i < lx.len && peek(&lx, 0) != '\n') {
                 adv(&lx, 1);
-            }
-            continue;
-        }
-
-        if (two0 == '=' && two1 == '=') {
-            if (!emit_simple(&lx, out, err, TOK_EQEQ, STR_LIT("=="), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_EQEQ);
-            continue;
-        }
-        if (two0 == '=' && two1 == ':') {
-            if (!emit_simple(&lx, out, err, TOK_EQ_COLON, STR_LIT("=:"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_EQ_COLON);
-            continue;
-        }
-        if (two0 == '!' && two1 == '=') {
-            if (!emit_simple(&lx, out, err, TOK_NEQ, STR_LIT("!="), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_NEQ);
-            continue;
-        }
-        if (two0 == '!' && two1 == ':') {
-            if (!emit_simple(&lx, out, err, TOK_BANG_COLON, STR_LIT("!:"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_BANG_COLON);
-            continue;
-        }
-        if (two0 == '<' && two1 == '=') {
-            if (!emit_simple(&lx, out, err, TOK_LTE, STR_LIT("<="), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_LTE);
-            continue;
-        }
-        if (two0 == '<' && two1 == '-') {
-            if (!emit_simple(&lx, out, err, TOK_ARROW_LEFT, STR_LIT("<-"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_ARROW_LEFT);
-            continue;
-        }
-        if (two0 == '>' && two1 == '=') {
-            if (!emit_simple(&lx, out, err, TOK_GTE, STR_LIT(">="), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_GTE);
-            continue;
-        }
-        if (two0 == '&' && two1 == '&') {
-            if (!emit_simple(&lx, out, err, TOK_ANDAND, STR_LIT("&&"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_ANDAND);
-            continue;
-        }
-        if (two0 == '|' && two1 == '|') {
-            if (!emit_simple(&lx, out, err, TOK_OROR, STR_LIT("||"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_OROR);
-            continue;
-        }
-        if (two0 == '|' && two1 == ':') {
-            if (!emit_simple(&lx, out, err, TOK_BAR_COLON, STR_LIT("|:"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_BAR_COLON);
-            continue;
-        }
-        if (two0 == '=' && two1 == '>') {
-            if (!emit_simple(&lx, out, err, TOK_ARROW, STR_LIT("=>"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_ARROW);
-            continue;
-        }
-        if (two0 == '+' && two1 == '=') {
-            if (!emit_simple(&lx, out, err, TOK_PLUSEQ, STR_LIT("+="), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_PLUSEQ);
-            continue;
-        }
-        if (two0 == '-' && two1 == '=') {
-            if (!emit_simple(&lx, out, err, TOK_MINUSEQ, STR_LIT("-="), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_MINUSEQ);
-            continue;
-        }
-        if (two0 == '*' && two1 == '=') {
-            if (!emit_simple(&lx, out, err, TOK_STAREQ, STR_LIT("*="), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_STAREQ);
-            continue;
-        }
-        if (two0 == '/' && two1 == '=') {
-            if (!emit_simple(&lx, out, err, TOK_SLASHEQ, STR_LIT("/="), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_SLASHEQ);
-            continue;
-        }
-        if (two0 == '%' && two1 == '=') {
-            if (!emit_simple(&lx, out, err, TOK_PERCENTEQ, STR_LIT("%="), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_PERCENTEQ);
-            continue;
-        }
-        if (two0 == '?' && two1 == '?') {
-            if (!emit_simple(&lx, out, err, TOK_QQ, STR_LIT("??"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_QQ);
-            continue;
-        }
-        if (two0 == ',' && two1 == ':') {
-            if (!emit_simple(&lx, out, err, TOK_COMMA_COLON, STR_LIT(",:"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_COMMA_COLON);
-            continue;
-        }
-        if (two0 == '.' && two1 == ':') {
-            if (!emit_simple(&lx, out, err, TOK_DOTCOLON, STR_LIT(".:"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_DOTCOLON);
-            continue;
-        }
-        if (two0 == ':' && two1 == ':') {
-            if (!emit_simple(&lx, out, err, TOK_COLONCOLON, STR_LIT("::"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 2);
-            set_last(&lx, TOK_COLONCOLON);
-            continue;
-        }
-        if (ch == ':') {
-            if (!emit_simple(&lx, out, err, TOK_COLON, STR_LIT(":"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 1);
-            set_last(&lx, TOK_COLON);
-            continue;
-        }
-
-        if (ch == ';') {
-            if (!emit_simple(&lx, out, err, TOK_SEMI, STR_LIT(";"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 1);
-            lx.last_real = TOK_SEMI;
-            continue;
+                lx.last_real = TOK_SEMI;
+                continue;
+            case '#':
+                if (!emit_op(&lx, out, err, TOK_HASH, STR_LIT("#"), 1)) return false;
+                continue;
+            default:
+                break;
         }
 
         if (ch == '(' || ch == ')' || ch == '[' || ch == ']' || ch == '{' || ch == '}' ||
@@ -989,24 +1102,6 @@ bool lex_source(const char *path, const char *src, size_t len, Arena *arena, Tok
             continue;
         }
 
-        if (ch == '?') {
-            if (!emit_simple(&lx, out, err, TOK_QMARK, STR_LIT("?"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 1);
-            set_last(&lx, TOK_QMARK);
-            continue;
-        }
-
-        if (ch == '#') {
-            if (!emit_simple(&lx, out, err, TOK_HASH, STR_LIT("#"), lx.line, lx.col)) {
-                return false;
-            }
-            adv(&lx, 1);
-            set_last(&lx, TOK_HASH);
-            continue;
-        }
-
         if (ch == '"') {
             int start_line = lx.line;
             int start_col = lx.col;
@@ -1045,6 +1140,7 @@ bool lex_source(const char *path, const char *src, size_t len, Arena *arena, Tok
                 }
                 if (c == '\\') {
                     adv(&lx, 1);
+                    lex_sync(&lx);
                     char e = peek(&lx, 0);
                     if (e == 'n') {
                         if (!charvec_push(&buf, '\n', err, &lx)) { return false; }
@@ -1093,6 +1189,7 @@ bool lex_source(const char *path, const char *src, size_t len, Arena *arena, Tok
                         adv(&lx, 1);
                     } else if (e == 'x') {
                         adv(&lx, 1);
+                        lex_sync(&lx);
                         if (!append_hex_escape(&lx, &buf, err, lx.line, lx.col)) {
                             strpartvec_free(&parts);
                             charvec_free(&buf);
@@ -1111,6 +1208,7 @@ bool lex_source(const char *path, const char *src, size_t len, Arena *arena, Tok
                             if (!charvec_push(&hexbuf, peek(&lx, 0), err, &lx)) { return false; }
                             adv(&lx, 1);
                         }
+                        lex_sync(&lx);
                         if (peek(&lx, 0) != '}') {
                             strpartvec_free(&parts);
                             charvec_free(&buf);
@@ -1118,6 +1216,7 @@ bool lex_source(const char *path, const char *src, size_t len, Arena *arena, Tok
                             return set_error(&lx, err, lx.line, lx.col, "bad \\u{...} escape");
                         }
                         adv(&lx, 1);
+                        lex_sync(&lx);
                         if (!append_hex_code(&lx, &buf, hexbuf.data, hexbuf.len, err, lx.line, lx.col)) {
                             strpartvec_free(&parts);
                             charvec_free(&buf);
@@ -1294,62 +1393,8 @@ bool lex_source(const char *path, const char *src, size_t len, Arena *arena, Tok
         }
 
         if (is_ident_start(ch)) {
-            int start_line = lx.line;
-            int start_col = lx.col;
-            size_t start = lx.i;
-            while (lx.i < lx.len && is_ident_mid(peek(&lx, 0))) {
-                adv(&lx, 1);
-            }
-            size_t end = lx.i;
-            Str word = str_from_slice(&lx.src[start], end - start);
-
-            TokKind kw = TOK_INVALID;
-            switch (word.len) {
-            case 2:
-                if (word.data[0] == 'i' && word.data[1] == 'f') kw = TOK_KW_if;
-                else if (word.data[0] == 'i' && word.data[1] == 'n') kw = TOK_KW_in;
-                break;
-            case 3:
-                // Use direct character comparison for better branch prediction
-                if (word.data[0] == 'p' && word.data[1] == 'u' && word.data[2] == 'b') kw = TOK_KW_pub;
-                else if (word.data[0] == 'd' && word.data[1] == 'e' && word.data[2] == 'f') kw = TOK_KW_def;
-                else if (word.data[0] == 'l' && word.data[1] == 'e' && word.data[2] == 't') kw = TOK_KW_let;
-                else if (word.data[0] == 'f' && word.data[1] == 'o' && word.data[2] == 'r') kw = TOK_KW_for;
-                else if (word.data[0] == 'n' && word.data[1] == 'e' && word.data[2] == 'w') kw = TOK_KW_new;
-                break;
-            case 4:
-                // Use memcmp with length check already done by case
-                if (memcmp(word.data, "cask", 4) == 0) kw = TOK_KW_cask;
-                else if (memcmp(word.data, "lock", 4) == 0) kw = TOK_KW_lock;
-                else if (memcmp(word.data, "seal", 4) == 0) kw = TOK_KW_seal;
-                else if (memcmp(word.data, "else", 4) == 0) kw = TOK_KW_else;
-                else if (memcmp(word.data, "elif", 4) == 0) kw = TOK_KW_elif;
-                else if (memcmp(word.data, "true", 4) == 0) kw = TOK_KW_true;
-                else if (memcmp(word.data, "null", 4) == 0) kw = TOK_KW_null;
-                break;
-            case 5:
-                if (memcmp(word.data, "bring", 5) == 0) kw = TOK_KW_bring;
-                else if (memcmp(word.data, "class", 5) == 0) kw = TOK_KW_class;
-                else if (memcmp(word.data, "const", 5) == 0) kw = TOK_KW_const;
-                else if (memcmp(word.data, "false", 5) == 0) kw = TOK_KW_false;
-                else if (memcmp(word.data, "match", 5) == 0) kw = TOK_KW_match;
-                else if (memcmp(word.data, "break", 5) == 0) kw = TOK_KW_break;
-                break;
-            case 8:
-                if (memcmp(word.data, "continue", 8) == 0) kw = TOK_KW_continue;
-                break;
-            }
-
-            if (kw != TOK_INVALID) {
-                if (!emit_simple(&lx, out, err, kw, word, start_line, start_col)) {
-                    return false;
-                }
-                set_last(&lx, kw);
-            } else {
-                if (!emit_ident(&lx, out, err, word, start_line, start_col)) {
-                    return false;
-                }
-                set_last(&lx, TOK_IDENT);
+            if (!lex_word(&lx, out, err)) {
+                return false;
             }
             continue;
         }
@@ -1365,6 +1410,7 @@ bool lex_source(const char *path, const char *src, size_t len, Arena *arena, Tok
         }
     }
 
+    lex_sync(&lx);
     if (lx.nest == 0 && is_stmt_end(lx.last_sig)) {
         if (!emit_simple(&lx, out, err, TOK_NEWLINE_SEMI, STR_LIT(";"), lx.line, lx.col)) {
             return false;
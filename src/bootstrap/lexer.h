@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "arena.h"
 #include "diag.h"
@@ -114,6 +115,10 @@ typedef struct {
 
 typedef struct {
     TokKind kind;
+    // For TOK_IDENT, str_hash() of text, computed while scanning; 0 otherwise.
+    // The parser copies it onto AST names so the typechecker's locals and
+    // global tables look them up without hashing again.
+    uint32_t hash;
     Str text;
     int line;
     int col;
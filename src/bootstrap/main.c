@@ -10,8 +10,10 @@
 #define yis_getcwd _getcwd
 #define yis_mkdir(path) _mkdir(path)
 #else
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #define yis_getcwd getcwd
 #define yis_mkdir(path) mkdir((path), 0755)
 #endif
@@ -215,6 +217,7 @@ static void print_usage(FILE *out) {
     fprintf(out, "  -h, --help       Show this help message\n");
     fprintf(out, "  -v, --version    Show version information\n");
     fprintf(out, "  --verbose        Enable verbose error output with more context\n");
+    fprintf(out, "  -j, --jobs N     Compile up to N modules in parallel (run option)\n");
     fprintf(out, "\n");
     fprintf(out, "Bootstrap scope:\n");
     fprintf(out, "  This binary is only for building the self-hosted compiler from src/init.yi.\n");
@@ -228,6 +231,7 @@ static void print_usage(FILE *out) {
     fprintf(out, "  YIS_CACHE_DIR   Cache directory for compiled binaries\n");
     fprintf(out, "  YIS_NO_CACHE    Set to 1 to disable caching\n");
     fprintf(out, "  YIS_KEEP_C      Set to 1 to keep generated C files\n");
+    fprintf(out, "  YIS_JOBS        Default for -j (default: number of CPUs)\n");
     fprintf(out, "  CC              C compiler to use (default: cc)\n");
     fprintf(out, "  YIS_CC_FLAGS    Additional C compiler flags\n");
     fprintf(out, "  NO_COLOR        Set to disable colored output\n");
@@ -506,6 +510,8 @@ static void write_err_prefix(const char *loc) {
     }
 }
 
+static int report_cc_output(char *buf, size_t buf_len, int rc);
+
 static int compile_c_with_translated_errors(const char *cmd) {
     // Redirect stderr → stdout so popen captures everything
     char full_cmd[4200];
@@ -536,7 +542,12 @@ static int compile_c_with_translated_errors(const char *cmd) {
     }
     int rc = pclose(fp);
     if (buf) buf[buf_len] = '\0';
+    return report_cc_output(buf, buf_len, rc);
+}
 
+// Translate captured compiler output (stdout and stderr) for a compile that
+// exited with rc. Takes ownership of buf, which may be NULL.
+static int report_cc_output(char *buf, size_t buf_len, int rc) {
     // If compilation succeeded, clean up and return
     if (rc == 0) { free(buf); return 0; }
 
@@ -712,6 +723,264 @@ static int compile_c_with_translated_errors(const char *cmd) {
     return rc;
 }
 
+static bool keep_c_enabled(void) {
+    const char *keep_c = getenv("YIS_KEEP_C");
+    return keep_c && keep_c[0] && keep_c[0] != '0';
+}
+
+// Upper bound on concurrent unit compiles: -j, else YIS_JOBS, else one per CPU.
+static int build_jobs = 0;
+
+static int unit_build_jobs(void) {
+    if (build_jobs > 0) return build_jobs;
+    const char *env = getenv("YIS_JOBS");
+    if (env && env[0] && atoi(env) > 0) return atoi(env);
+#if defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 0) return (int)n;
+#endif
+    return 1;
+}
+
+// Write data to path through a temporary file, so readers never observe a
+// partially written file under the final name.
+static bool write_file_atomic(const char *path, const char *data, size_t len) {
+    size_t plen = strlen(path);
+    char *tmp = (char *)malloc(plen + 5);
+    if (!tmp) return false;
+    memcpy(tmp, path, plen);
+    memcpy(tmp + plen, ".tmp", 5);
+    FILE *f = fopen(tmp, "wb");
+    bool ok = f && fwrite(data, 1, len, f) == len;
+    if (f && fclose(f) != 0) ok = false;
+    if (ok && rename(tmp, path) != 0) ok = path_is_file(path);
+    if (!ok) (void)remove(tmp);
+    free(tmp);
+    return ok;
+}
+
+// The shared header is named after a hash of its text, so units that include
+// it by name change (and recompile) exactly when the header does.
+static char *write_unit_header(const CUnit *header, const char *units_dir) {
+    uint64_t h = 1469598103934665603ULL;
+    h = hash_cstr(h, YIS_CACHE_VERSION);
+    h = hash_update(h, header->text, header->len);
+    char name[512];
+    snprintf(name, sizeof(name), "%s-%016llx.h", header->name, (unsigned long long)h);
+    char *path = path_join(units_dir, name);
+    if (!path) return NULL;
+    if (!path_is_file(path) && !write_file_atomic(path, header->text, header->len)) {
+        fprintf(stderr, "error: cannot write %s\n", path);
+        free(path);
+        return NULL;
+    }
+    free(path);
+    return dup_cstr(name);
+}
+
+typedef struct {
+    const char *name;
+    char *c_file;
+    char *tmp_obj;
+    char *log;
+    char *cmd;
+    int status;
+#if !defined(_WIN32)
+    pid_t pid;
+#endif
+} UnitJob;
+
+static void unit_job_free(UnitJob *job) {
+    free(job->c_file);
+    free(job->tmp_obj);
+    free(job->log);
+    free(job->cmd);
+}
+
+#if !defined(_WIN32)
+static pid_t spawn_logged(const char *cmd, const char *log_path) {
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+    int fd = open(log_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+    }
+    execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+    _exit(127);
+}
+#endif
+
+// Run the unit compiles, at most max_jobs at a time. Once one fails no new
+// compile is started; the ones in flight are waited for. Returns the index
+// of the first failed job in unit order, or jobs_len if all succeeded.
+static size_t run_unit_jobs(UnitJob *jobs, size_t jobs_len, int max_jobs) {
+#if defined(_WIN32)
+    (void)max_jobs;
+    for (size_t i = 0; i < jobs_len; i++) {
+        jobs[i].status = compile_c_with_translated_errors(jobs[i].cmd);
+        if (jobs[i].status != 0) return i;
+    }
+    return jobs_len;
+#else
+    size_t next = 0, running = 0;
+    bool failed = false;
+    fflush(stdout);
+    fflush(stderr);
+    while (running > 0 || (!failed && next < jobs_len)) {
+        while (!failed && next < jobs_len && running < (size_t)max_jobs) {
+            UnitJob *job = &jobs[next++];
+            job->pid = spawn_logged(job->cmd, job->log);
+            if (job->pid < 0) {
+                job->status = -1;
+                failed = true;
+            } else {
+                running++;
+            }
+        }
+        if (running == 0) break;
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (size_t i = 0; i < next; i++) {
+            if (jobs[i].pid != pid) continue;
+            jobs[i].pid = 0;
+            jobs[i].status = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+            if (jobs[i].status != 0) failed = true;
+            running--;
+            break;
+        }
+    }
+    for (size_t i = 0; i < jobs_len; i++) {
+        if (i >= next || jobs[i].status != 0) return i;
+    }
+    return jobs_len;
+#endif
+}
+
+// Split build: each module's unit becomes an object cached in units_dir under
+// a hash of its generated C and the compiler settings, and the objects are
+// linked into bin_path. A unit's text only changes when its module or an
+// interface it sees changes, so editing one module recompiles one object.
+// Stale units are compiled as parallel jobs.
+static int build_module_objects(const CUnit *units, size_t units_len, const char *units_dir,
+                                const char *bin_path, const char *extra_cflags,
+                                const char *extra_ldflags) {
+    bool keep_c = keep_c_enabled();
+    char **objs = (char **)calloc(units_len ? units_len : 1, sizeof(char *));
+    UnitJob *jobs = (UnitJob *)calloc(units_len ? units_len : 1, sizeof(UnitJob));
+    size_t *job_unit = (size_t *)calloc(units_len ? units_len : 1, sizeof(size_t));
+    if (!objs || !jobs || !job_unit) {
+        free(objs);
+        free(jobs);
+        free(job_unit);
+        return 1;
+    }
+    size_t jobs_len = 0;
+    int rc = 0;
+    size_t link_len = strlen(cc_path()) + strlen(cc_flags()) + strlen(bin_path) + strlen(extra_ldflags) + 24;
+    for (size_t i = 0; i < units_len && rc == 0; i++) {
+        const CUnit *u = &units[i];
+        uint64_t h = 1469598103934665603ULL;
+        h = hash_cstr(h, YIS_CACHE_VERSION);
+        h = hash_cstr(h, cc_path());
+        h = hash_cstr(h, cc_flags());
+        h = hash_cstr(h, extra_cflags);
+        h = hash_update(h, u->text, u->len);
+        char base[512];
+        snprintf(base, sizeof(base), "%s-%016llx", u->name, (unsigned long long)h);
+        char file[600];
+        snprintf(file, sizeof(file), "%s.o", base);
+        objs[i] = path_join(units_dir, file);
+        if (!objs[i]) { rc = 1; break; }
+        link_len += strlen(objs[i]) + 3;
+        if (path_is_file(objs[i])) {
+            if (verbose_mode) fprintf(stderr, "[yis] %s: up to date\n", u->name);
+            continue;
+        }
+        UnitJob *job = &jobs[jobs_len];
+        job->name = u->name;
+        snprintf(file, sizeof(file), "%s.c", base);
+        job->c_file = path_join(units_dir, file);
+        snprintf(file, sizeof(file), "%s.o.tmp", base);
+        job->tmp_obj = path_join(units_dir, file);
+        snprintf(file, sizeof(file), "%s.log", base);
+        job->log = path_join(units_dir, file);
+        job_unit[jobs_len++] = i;
+        if (!job->c_file || !job->tmp_obj || !job->log ||
+            !write_file_atomic(job->c_file, u->text, u->len)) {
+            fprintf(stderr, "error: cannot write %s\n", job->c_file ? job->c_file : base);
+            rc = 1;
+            break;
+        }
+        size_t cmd_len = strlen(cc_path()) + strlen(cc_flags()) + strlen(extra_cflags) +
+                         strlen(job->c_file) + strlen(job->tmp_obj) + 16;
+        job->cmd = (char *)malloc(cmd_len);
+        if (!job->cmd) { rc = 1; break; }
+        snprintf(job->cmd, cmd_len, "%s %s %s -c %s -o %s",
+                 cc_path(), cc_flags(), extra_cflags, job->c_file, job->tmp_obj);
+    }
+    if (rc == 0 && jobs_len > 0) {
+        int max_jobs = unit_build_jobs();
+        if (verbose_mode) {
+            for (size_t j = 0; j < jobs_len; j++) fprintf(stderr, "[yis] %s: compiling\n", jobs[j].name);
+            fprintf(stderr, "[yis] %zu unit(s), %d job(s)\n", jobs_len, max_jobs);
+        }
+        size_t failed = run_unit_jobs(jobs, jobs_len, max_jobs);
+        if (failed < jobs_len) {
+            rc = jobs[failed].status ? jobs[failed].status : 1;
+#if !defined(_WIN32)
+            Arena log_arena;
+            arena_init(&log_arena);
+            size_t log_len = 0;
+            char *log = read_file_arena(jobs[failed].log, &log_arena, &log_len, NULL);
+            char *buf = log ? (char *)malloc(log_len + 1) : NULL;
+            if (buf) {
+                memcpy(buf, log, log_len);
+                buf[log_len] = '\0';
+            }
+            arena_free(&log_arena);
+            rc = report_cc_output(buf, buf ? log_len : 0, rc);
+#endif
+        }
+        // Publish objects only once they are complete, so an interrupted
+        // compile never leaves a truncated object behind a valid name.
+        for (size_t j = 0; j < jobs_len; j++) {
+            UnitJob *job = &jobs[j];
+            if (rc == 0 && rename(job->tmp_obj, objs[job_unit[j]]) != 0) {
+                if (!path_is_file(objs[job_unit[j]])) rc = 1;
+            }
+            (void)remove(job->tmp_obj);
+            (void)remove(job->log);
+            if (!keep_c) (void)remove(job->c_file);
+        }
+    }
+    for (size_t j = 0; j < jobs_len; j++) unit_job_free(&jobs[j]);
+    free(jobs);
+    free(job_unit);
+    if (rc == 0) {
+        char *cmd = (char *)malloc(link_len);
+        if (!cmd) {
+            rc = 1;
+        } else {
+            size_t off = (size_t)snprintf(cmd, link_len, "%s %s", cc_path(), cc_flags());
+            for (size_t i = 0; i < units_len; i++) {
+                off += (size_t)snprintf(cmd + off, link_len - off, " %s", objs[i]);
+            }
+            snprintf(cmd + off, link_len - off, " -o %s %s -lm", bin_path, extra_ldflags);
+            rc = compile_c_with_translated_errors(cmd);
+            free(cmd);
+        }
+    }
+    for (size_t i = 0; i < units_len; i++) free(objs[i]);
+    free(objs);
+    return rc;
+}
+
 int main(int argc, char **argv) {
     yis_set_stdout_buffered();
 
@@ -762,6 +1031,16 @@ int main(int argc, char **argv) {
                 run_argv = run_argc > 0 ? &argv[i + 1] : NULL;
                 break;
             }
+            if (is_flag(argv[i], "-j") || is_flag(argv[i], "--jobs") ||
+                (strncmp(argv[i], "-j", 2) == 0 && argv[i][2])) {
+                const char *jobs_arg = argv[i][2] && argv[i][1] == 'j' ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : "");
+                build_jobs = atoi(jobs_arg);
+                if (build_jobs <= 0) {
+                    fprintf(stderr, "error: -j expects a positive job count\n");
+                    return 2;
+                }
+                continue;
+            }
             if (argv[i][0] == '-') {
                 fprintf(stderr, "error: unknown option %s\n", argv[i]);
                 return 2;
@@ -904,6 +1183,7 @@ int main(int argc, char **argv) {
         char *cache_dir = NULL;
         char *cache_c = NULL;
         char *cache_bin = NULL;
+        char *cache_units = NULL;
         if (cache_enabled) {
             cache_base = cache_base_dir();
             if (cache_base && ensure_dir(cache_base)) {
@@ -916,6 +1196,11 @@ int main(int argc, char **argv) {
                     cache_c = path_join(cache_dir, cache_c_name);
                     cache_bin = path_join(cache_dir, unique_bin_name);
                 }
+                cache_units = path_join(cache_base, "units");
+                if (cache_units && !ensure_dir(cache_units)) {
+                    free(cache_units);
+                    cache_units = NULL;
+                }
             }
         }
 
@@ -927,6 +1212,7 @@ int main(int argc, char **argv) {
             free(cache_dir);
             free(cache_c);
             free(cache_bin);
+            free(cache_units);
             arena_free(&arena);
             return rc == 0 ? 0 : 1;
         }
@@ -960,6 +1246,7 @@ int main(int argc, char **argv) {
             free(cache_dir);
             free(cache_c);
             free(cache_bin);
+            free(cache_units);
             arena_free(&arena);
             return 1;
         }
@@ -971,6 +1258,7 @@ int main(int argc, char **argv) {
             free(cache_dir);
             free(cache_c);
             free(cache_bin);
+            free(cache_units);
             arena_free(&arena);
             return 1;
         }
@@ -984,13 +1272,33 @@ int main(int argc, char **argv) {
         snprintf(run_cmd_buf, sizeof(run_cmd_buf), "./%s", unique_bin_name);
 #endif
         const char *run_cmd = cache_bin ? cache_bin : run_cmd_buf;
-        if (!emit_c(prog, c_path, ext_module_name, ext_bindings_path_str, &err)) {
+        // With a cache, compile per module so unchanged modules reuse objects.
+        bool split_build = cache_units && !uses_ext_module;
+        CUnit *units = NULL;
+        size_t units_len = 0;
+        bool emitted;
+        if (split_build) {
+            CUnit header = {0};
+            char *header_name = NULL;
+            emitted = emit_c_header(prog, &header, &err);
+            if (emitted) {
+                header_name = write_unit_header(&header, cache_units);
+                emitted = header_name && emit_c_units(prog, header_name, &units, &units_len, &err);
+            }
+            free(header.name);
+            free(header.text);
+            free(header_name);
+        } else {
+            emitted = emit_c(prog, c_path, ext_module_name, ext_bindings_path_str, &err);
+        }
+        if (!emitted) {
             diag_print_enhanced(&err, verbose_mode);
             free(ext_bindings_alloc);
             free(cache_base);
             free(cache_dir);
             free(cache_c);
             free(cache_bin);
+            free(cache_units);
             arena_free(&arena);
             return 1;
         }
@@ -1004,6 +1312,8 @@ int main(int argc, char **argv) {
                 free(cache_dir);
                 free(cache_c);
                 free(cache_bin);
+                c_units_free(units, units_len);
+                free(cache_units);
                 arena_free(&arena);
                 return 1;
             }
@@ -1025,21 +1335,21 @@ int main(int argc, char **argv) {
                 (void)system(embed_cmd);
         }
 #endif
-        char cmd[4096];
-        int n = snprintf(cmd, sizeof(cmd), "%s %s %s %s -o %s %s",
-                         cc_path(), cc_flags(), extra_cflags, c_path, bin_path, extra_ldflags);
-        if (n < 0 || (size_t)n >= sizeof(cmd)) {
-            fprintf(stderr, "error: compile command too long\n");
-            free(ext_bindings_alloc);
-            free(ext_packager_alloc);
-            free(cache_base);
-            free(cache_dir);
-            free(cache_c);
-            free(cache_bin);
-            arena_free(&arena);
-            return 1;
+        int rc;
+        if (split_build) {
+            rc = build_module_objects(units, units_len, cache_units, bin_path, extra_cflags, extra_ldflags);
+            c_units_free(units, units_len);
+        } else {
+            char cmd[4096];
+            int n = snprintf(cmd, sizeof(cmd), "%s %s %s %s -o %s %s",
+                             cc_path(), cc_flags(), extra_cflags, c_path, bin_path, extra_ldflags);
+            if (n < 0 || (size_t)n >= sizeof(cmd)) {
+                fprintf(stderr, "error: compile command too long\n");
+                rc = 1;
+            } else {
+                rc = compile_c_with_translated_errors(cmd);
+            }
         }
-        int rc = compile_c_with_translated_errors(cmd);
         if (rc != 0) {
             free(ext_bindings_alloc);
             free(ext_packager_alloc);
@@ -1047,6 +1357,7 @@ int main(int argc, char **argv) {
             free(cache_dir);
             free(cache_c);
             free(cache_bin);
+            free(cache_units);
             arena_free(&arena);
             return rc;
         }
@@ -1066,11 +1377,11 @@ int main(int argc, char **argv) {
             free(cache_dir);
             free(cache_c);
             free(cache_bin);
+            free(cache_units);
             arena_free(&arena);
             return 2;
         }
-        const char *keep_c = getenv("YIS_KEEP_C");
-        if (!(keep_c && keep_c[0] && keep_c[0] != '0')) {
+        if (!split_build && !keep_c_enabled()) {
             (void)remove(c_path);
         }
         // Compile-time AST/type data is no longer needed after codegen/compile.
@@ -1083,6 +1394,7 @@ int main(int argc, char **argv) {
         free(cache_dir);
         free(cache_c);
         free(cache_bin);
+        free(cache_units);
         return rc == 0 ? 0 : 1;
     }
 
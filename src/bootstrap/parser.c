@@ -262,6 +262,7 @@ static Expr *parse_interp_expr(Parser *p, Tok *owner, Str text) {
         return NULL;
     }
     e->as.ident.name = toks.data[0].val.ident;
+    e->as.ident.hash = toks.data[0].hash;
 
     size_t i = 1;
     bool has_format = false;
@@ -303,6 +304,7 @@ static Expr *parse_interp_expr(Parser *p, Tok *owner, Str text) {
                 return NULL;
             }
             member->as.ident.name = toks.data[i - 1].val.ident;
+            member->as.ident.hash = toks.data[i - 1].hash;
             Expr *m = new_expr(p, EXPR_MEMBER, owner);
             if (!m) {
                 free(toks.data);
@@ -664,6 +666,7 @@ static Param **parse_params(Parser *p, size_t *out_len) {
             return NULL;
         }
         param->name = name_tok->val.ident;
+        param->name_hash = name_tok->hash;
         param->is_mut = is_mut;
         param->is_this = false;
         param->typ = NULL;
@@ -853,6 +856,7 @@ static Stmt *parse_stmt(Parser *p) {
         Stmt *st = new_stmt(p, STMT_LET, t);
         if (!st) return NULL;
         st->as.let_s.name = name_tok->val.ident;
+        st->as.let_s.name_hash = name_tok->hash;
         st->as.let_s.is_mut = is_mut;
         st->as.let_s.expr = expr;
         return st;
@@ -865,6 +869,7 @@ static Stmt *parse_stmt(Parser *p) {
         Stmt *st = new_stmt(p, STMT_CONST, t);
         if (!st) return NULL;
         st->as.const_s.name = name_tok->val.ident;
+        st->as.const_s.name_hash = name_tok->hash;
         st->as.const_s.expr = expr;
         return st;
     }
@@ -973,6 +978,7 @@ static Stmt *parse_stmt(Parser *p) {
             Stmt *st = new_stmt(p, STMT_FOREACH, t);
             if (!st) return NULL;
             st->as.foreach_s.name = name_tok->val.ident;
+            st->as.foreach_s.name_hash = name_tok->hash;
             st->as.foreach_s.expr = expr;
             st->as.foreach_s.body = body;
             return st;
@@ -1060,6 +1066,7 @@ static Decl *parse_const_decl(Parser *p, bool is_pub) {
     Decl *decl = new_decl(p, DECL_CONST, kw);
     if (!decl) return NULL;
     decl->as.const_decl.name = name_tok->val.ident;
+    decl->as.const_decl.name_hash = name_tok->hash;
     decl->as.const_decl.expr = expr;
     decl->as.const_decl.is_pub = is_pub;
     return decl;
@@ -1084,6 +1091,7 @@ static Decl *parse_def_decl(Parser *p, bool is_pub) {
     Decl *decl = new_decl(p, DECL_DEF, kw);
     if (!decl) return NULL;
     decl->as.def_decl.name = name_tok->val.ident;
+    decl->as.def_decl.name_hash = name_tok->hash;
     decl->as.def_decl.expr = expr;
     decl->as.def_decl.is_mut = is_mut;
     decl->as.def_decl.is_pub = is_pub;
@@ -1594,6 +1602,7 @@ static Expr *parse_primary(Parser *p) {
         Expr *e = new_expr(p, EXPR_IDENT, t);
         if (!e) return NULL;
         e->as.ident.name = t->val.ident;
+        e->as.ident.hash = t->hash;
         return e;
     }
     if (t->kind == TOK_KW_null) {
@@ -1775,6 +1784,7 @@ static Expr *parse_lambda_bracket(Parser *p) {
                 return NULL;
             }
             param->name = name_tok->val.ident;
+            param->name_hash = name_tok->hash;
             param->is_mut = is_mut;
             param->is_this = false;
             param->typ = NULL;
@@ -1854,6 +1864,7 @@ static Expr *parse_lambda(Parser *p) {
                 return NULL;
             }
             param->name = name_tok->val.ident;
+            param->name_hash = name_tok->hash;
             param->is_mut = is_mut;
             param->is_this = false;
             param->typ = NULL;
@@ -1896,6 +1907,7 @@ static Expr *parse_lambda_arrow(Parser *p) {
                 return NULL;
             }
             param->name = name_tok->val.ident;
+            param->name_hash = name_tok->hash;
             param->is_mut = is_mut;
             param->is_this = false;
             param->typ = NULL;
@@ -34,15 +34,24 @@ static const char yis_runtime_embedded[] =
 "#endif\n"
 "#include <unistd.h>\n"
 "\n"
-"static int yis_stdout_isatty = 0;\n"
+"// Process-wide state. A program split into several translation units\n"
+"// defines it in the unit holding main(); the others see it via\n"
+"// YIS_RT_EXTERN_STATE.\n"
+"#if defined(YIS_RT_EXTERN_STATE)\n"
+"extern int yis_stdout_isatty;\n"
+"extern int yis_argc;\n"
+"extern char **yis_argv;\n"
+"#else\n"
+"int yis_stdout_isatty = 0;\n"
 "\n"
-"static int yis_argc = 0;\n"
-"static char **yis_argv = NULL;\n"
+"int yis_argc = 0;\n"
+"char **yis_argv = NULL;\n"
 "\n"
 "void yis_set_args(int argc, char **argv) {\n"
 "  yis_argc = argc;\n"
 "  yis_argv = argv;\n"
 "}\n"
+"#endif\n"
 "\n"
 "static void yis_runtime_init(void) {\n"
 "#if defined(_WIN32)\n"
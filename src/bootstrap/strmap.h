@@ -0,0 +1,104 @@
+#ifndef YIS_STRMAP_H
+#define YIS_STRMAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "str.h"
+
+// Open-addressing hash map from Str to a size_t index, allocated in an arena.
+// Keys are borrowed, so they must outlive the map. The table never grows:
+// size it with the number of keys you will put.
+
+static inline uint32_t str_hash(Str s) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < s.len; i++) {
+        h ^= (uint8_t)s.data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+typedef struct {
+    Str key;
+    size_t value;
+    bool occupied;
+} StrMapEntry;
+
+typedef struct {
+    StrMapEntry *entries;
+    size_t cap;
+    size_t len;
+} StrMap;
+
+static inline void strmap_init(StrMap *m, Arena *arena, size_t expected) {
+    size_t cap = 16;
+    while (cap < expected * 2) cap *= 2;
+    m->entries = (StrMapEntry *)arena_alloc_zero(arena, sizeof(StrMapEntry) * cap);
+    m->cap = m->entries ? cap : 0;
+    m->len = 0;
+}
+
+// Hash recorded earlier (e.g. by the lexer for an identifier), or str_hash
+// of the key when none was (0).
+static inline uint32_t str_hash_known(Str s, uint32_t known) {
+    return known ? known : str_hash(s);
+}
+
+// The _hashed variants take str_hash(key) from a caller that already has it.
+static inline void strmap_put_hashed(StrMap *m, Str key, uint32_t hash, size_t value) {
+    if (!m->entries) return;
+    uint32_t idx = hash & (uint32_t)(m->cap - 1);
+    for (;;) {
+        if (!m->entries[idx].occupied) {
+            m->entries[idx].key = key;
+            m->entries[idx].value = value;
+            m->entries[idx].occupied = true;
+            m->len++;
+            return;
+        }
+        if (str_eq(m->entries[idx].key, key)) {
+            m->entries[idx].value = value;
+            return;
+        }
+        idx = (idx + 1) & (uint32_t)(m->cap - 1);
+    }
+}
+
+static inline void strmap_put(StrMap *m, Str key, size_t value) {
+    strmap_put_hashed(m, key, str_hash(key), value);
+}
+
+static inline bool strmap_get_hashed(const StrMap *m, Str key, uint32_t hash, size_t *out) {
+    if (!m->entries || m->len == 0) return false;
+    uint32_t idx = hash & (uint32_t)(m->cap - 1);
+    for (;;) {
+        if (!m->entries[idx].occupied) return false;
+        if (str_eq(m->entries[idx].key, key)) {
+            *out = m->entries[idx].value;
+            return true;
+        }
+        idx = (idx + 1) & (uint32_t)(m->cap - 1);
+    }
+}
+
+static inline bool strmap_get(const StrMap *m, Str key, size_t *out) {
+    return strmap_get_hashed(m, key, str_hash(key), out);
+}
+
+// Composite "a\0b" key for maps indexed by two names (e.g. cask + function).
+// Uses buf when it fits, otherwise allocates from arena; returns an empty Str
+// on allocation failure.
+static inline Str strmap_pair_key(char *buf, size_t buf_len, Arena *arena, Str a, Str b) {
+    size_t klen = a.len + 1 + b.len;
+    char *key = (klen <= buf_len) ? buf : (char *)arena_alloc(arena, klen);
+    if (!key) return (Str){ NULL, 0 };
+    memcpy(key, a.data, a.len);
+    key[a.len] = '\0';
+    memcpy(key + a.len + 1, b.data, b.len);
+    return (Str){ key, klen };
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stdint.h>
 
 #include "str.h"
 
@@ -792,6 +793,7 @@ static Stmt *lower_stmt(Arena *arena, Stmt *s, Diag *err) {
             Stmt *out = new_stmt_like(arena, s, STMT_LET, err);
             if (!out) return NULL;
             out->as.let_s.name = s->as.let_s.name;
+            out->as.let_s.name_hash = s->as.let_s.name_hash;
             out->as.let_s.is_mut = s->as.let_s.is_mut;
             out->as.let_s.expr = lower_expr(arena, s->as.let_s.expr, err);
             return out;
@@ -800,6 +802,7 @@ static Stmt *lower_stmt(Arena *arena, Stmt *s, Diag *err) {
             Stmt *out = new_stmt_like(arena, s, STMT_CONST, err);
             if (!out) return NULL;
             out->as.const_s.name = s->as.const_s.name;
+            out->as.const_s.name_hash = s->as.const_s.name_hash;
             out->as.const_s.expr = lower_expr(arena, s->as.const_s.expr, err);
             return out;
         }
@@ -859,6 +862,7 @@ static Stmt *lower_stmt(Arena *arena, Stmt *s, Diag *err) {
             Stmt *out = new_stmt_like(arena, s, STMT_FOREACH, err);
             if (!out) return NULL;
             out->as.foreach_s.name = s->as.foreach_s.name;
+            out->as.foreach_s.name_hash = s->as.foreach_s.name_hash;
             out->as.foreach_s.expr = lower_expr(arena, s->as.foreach_s.expr, err);
             out->as.foreach_s.body = lower_stmt(arena, s->as.foreach_s.body, err);
             return out;
@@ -1097,152 +1101,266 @@ Program *lower_program(Program *prog, Arena *arena, Diag *err) {
 }
 
 // ----------------------------
-// Type system helpers
+// Local bindings
 // ----------------------------
 
+// All bindings of a function body live in one LocalStore as a stack of slots.
+// Each slot is also threaded onto a hash bucket chain, newest first, so a
+// lookup returns the innermost binding after a single bucket walk, and
+// popping a scope just unlinks the slots it pushed. Slots sit in fixed-size
+// blocks that never move, because callers keep Binding pointers across
+// later defines.
+//
+// Clones (for if/match arms and lambda bodies) share the store. While a clone
+// is live, the first lookup of an older slot logs its Binding to an undo log,
+// since callers refine types through the returned pointer. Freeing the clone
+// replays the log and drops the slots pushed since, which restores the
+// source exactly.
+
+#define LOCAL_BLOCK_SHIFT 8
+#define LOCAL_BLOCK_SIZE ((size_t)1 << LOCAL_BLOCK_SHIFT)
+#define LOCAL_NONE ((size_t)-1)
+
 typedef struct {
     Str name;
-    Ty *ty;
-} SubstEntry;
+    uint32_t hash;
+    unsigned saved_gen;  // clone generation that already logged this slot
+    size_t next;         // older slot in the same bucket, or LOCAL_NONE
+    Binding binding;
+} LocalSlot;
 
 typedef struct {
-    SubstEntry *data;
-    size_t len;
-    size_t cap;
-} Subst;
+    size_t slot;
+    unsigned saved_gen;
+    Binding binding;
+} LocalUndo;
+
+struct LocalStore {
+    LocalSlot **blocks;
+    size_t blocks_len;
+    size_t len;           // live slots
+    size_t *buckets;      // newest slot per bucket, or LOCAL_NONE
+    size_t buckets_cap;   // power of two
+    size_t *scopes;       // first slot of each open scope
+    size_t scopes_len;
+    size_t scopes_cap;
+    LocalUndo *undo;
+    size_t undo_len;
+    size_t undo_cap;
+    size_t clone_mark;    // slots below this predate the innermost clone
+    unsigned gen;         // innermost clone generation, 0 when none
+    unsigned gen_counter;
+};
+
+static LocalSlot *local_slot(LocalStore *st, size_t i) {
+    return &st->blocks[i >> LOCAL_BLOCK_SHIFT][i & (LOCAL_BLOCK_SIZE - 1)];
+}
 
-void locals_init(Locals *loc) {
-    loc->scopes = NULL;
-    loc->len = 0;
-    loc->cap = 0;
-    // push root scope
-    if (loc->len + 1 > loc->cap) {
-        size_t next = loc->cap ? loc->cap * 2 : 4;
-        LocalScope *sc = (LocalScope *)malloc(next * sizeof(LocalScope));
-        if (!sc) {
-            return;
-        }
-        loc->scopes = sc;
-        loc->cap = next;
+static bool local_buckets_resize(LocalStore *st, size_t cap) {
+    size_t *b = (size_t *)malloc(cap * sizeof(size_t));
+    if (!b) return false;
+    for (size_t i = 0; i < cap; i++) b[i] = LOCAL_NONE;
+    // Relink oldest to newest so every chain stays newest-first.
+    for (size_t i = 0; i < st->len; i++) {
+        LocalSlot *sl = local_slot(st, i);
+        size_t h = sl->hash & (cap - 1);
+        sl->next = b[h];
+        b[h] = i;
+    }
+    free(st->buckets);
+    st->buckets = b;
+    st->buckets_cap = cap;
+    return true;
+}
+
+static bool locals_scope_push(LocalStore *st) {
+    if (st->scopes_len + 1 > st->scopes_cap) {
+        size_t next = st->scopes_cap ? st->scopes_cap * 2 : 8;
+        size_t *sc = (size_t *)realloc(st->scopes, next * sizeof(size_t));
+        if (!sc) return false;
+        st->scopes = sc;
+        st->scopes_cap = next;
     }
-    loc->scopes[0].entries = NULL;
-    loc->scopes[0].len = 0;
-    loc->scopes[0].cap = 0;
-    loc->len = 1;
+    st->scopes[st->scopes_len++] = st->len;
+    return true;
 }
 
-void locals_free(Locals *loc) {
-    if (!loc) return;
-    for (size_t i = 0; i < loc->len; i++) {
-        free(loc->scopes[i].entries);
-    }
-    free(loc->scopes);
-    loc->scopes = NULL;
-    loc->len = 0;
-    loc->cap = 0;
+static void locals_truncate(LocalStore *st, size_t len) {
+    while (st->len > len) {
+        LocalSlot *sl = local_slot(st, st->len - 1);
+        st->buckets[sl->hash & (st->buckets_cap - 1)] = sl->next;
+        st->len--;
+    }
 }
 
-void locals_push(Locals *loc) {
-    if (loc->len + 1 > loc->cap) {
-        size_t next = loc->cap ? loc->cap * 2 : 4;
-        LocalScope *sc = (LocalScope *)realloc(loc->scopes, next * sizeof(LocalScope));
-        if (!sc) {
-            return;
+static LocalSlot *locals_find(LocalStore *st, Str name, uint32_t hash, size_t *index) {
+    for (size_t i = st->buckets[hash & (st->buckets_cap - 1)]; i != LOCAL_NONE;) {
+        LocalSlot *sl = local_slot(st, i);
+        if (sl->hash == hash && str_eq(sl->name, name)) {
+            *index = i;
+            return sl;
         }
-        loc->scopes = sc;
-        loc->cap = next;
+        i = sl->next;
     }
-    LocalScope *s = &loc->scopes[loc->len++];
-    s->entries = NULL;
-    s->len = 0;
-    s->cap = 0;
+    return NULL;
 }
 
-void locals_pop(Locals *loc) {
-    if (loc->len == 0) return;
-    LocalScope *s = &loc->scopes[loc->len - 1];
-    free(s->entries);
-    loc->len -= 1;
+// Called before handing out a mutable pointer to a slot older than the
+// innermost clone.
+static void locals_log(LocalStore *st, LocalSlot *sl, size_t index) {
+    if (index >= st->clone_mark || sl->saved_gen == st->gen) return;
+    if (st->undo_len + 1 > st->undo_cap) {
+        size_t next = st->undo_cap ? st->undo_cap * 2 : 16;
+        LocalUndo *u = (LocalUndo *)realloc(st->undo, next * sizeof(LocalUndo));
+        if (!u) return;
+        st->undo = u;
+        st->undo_cap = next;
+    }
+    st->undo[st->undo_len].slot = index;
+    st->undo[st->undo_len].saved_gen = sl->saved_gen;
+    st->undo[st->undo_len].binding = sl->binding;
+    st->undo_len++;
+    sl->saved_gen = st->gen;
 }
 
-static LocalEntry *locals_find_in_scope(LocalScope *scope, Str name) {
-    for (size_t i = 0; i < scope->len; i++) {
-        if (str_eq(scope->entries[i].name, name)) {
-            return &scope->entries[i];
+void locals_init(Locals *loc) {
+    memset(loc, 0, sizeof(*loc));
+    LocalStore *st = (LocalStore *)calloc(1, sizeof(LocalStore));
+    if (!st) return;
+    if (!local_buckets_resize(st, 64) || !locals_scope_push(st)) {
+        free(st->buckets);
+        free(st);
+        return;
+    }
+    loc->store = st;
+}
+
+void locals_free(Locals *loc) {
+    if (!loc || !loc->store) return;
+    LocalStore *st = loc->store;
+    if (loc->is_clone) {
+        while (st->undo_len > loc->undo_mark) {
+            LocalUndo *u = &st->undo[--st->undo_len];
+            LocalSlot *sl = local_slot(st, u->slot);
+            sl->binding = u->binding;
+            sl->saved_gen = u->saved_gen;
+        }
+        locals_truncate(st, loc->slot_mark);
+        st->scopes_len = loc->scope_mark;
+        st->clone_mark = loc->parent_slot_mark;
+        st->gen = loc->parent_gen;
+    } else {
+        for (size_t i = 0; i < st->blocks_len; i++) {
+            free(st->blocks[i]);
         }
+        free(st->blocks);
+        free(st->buckets);
+        free(st->scopes);
+        free(st->undo);
+        free(st);
     }
-    return NULL;
+    loc->store = NULL;
 }
 
-void locals_define(Locals *loc, Str name, Binding b) {
-    if (loc->len == 0) {
+void locals_push(Locals *loc) {
+    if (!loc->store) return;
+    locals_scope_push(loc->store);
+}
+
+void locals_pop(Locals *loc) {
+    LocalStore *st = loc->store;
+    if (!st || st->scopes_len == 0) return;
+    locals_truncate(st, st->scopes[--st->scopes_len]);
+}
+
+void locals_define_hashed(Locals *loc, Str name, uint32_t hash, Binding b) {
+    LocalStore *st = loc->store;
+    if (!st || st->scopes_len == 0) {
         return;
     }
-    LocalScope *scope = &loc->scopes[loc->len - 1];
-    LocalEntry *existing = locals_find_in_scope(scope, name);
-    if (existing) {
+    size_t index;
+    LocalSlot *existing = locals_find(st, name, hash, &index);
+    if (existing && index >= st->scopes[st->scopes_len - 1]) {
+        locals_log(st, existing, index);
         existing->binding = b;
         return;
     }
-    if (scope->len + 1 > scope->cap) {
-        size_t next = scope->cap ? scope->cap * 2 : 8;
-        LocalEntry *ents = (LocalEntry *)realloc(scope->entries, next * sizeof(LocalEntry));
-        if (!ents) {
-            return;
-        }
-        scope->entries = ents;
-        scope->cap = next;
+    if (st->len == st->blocks_len * LOCAL_BLOCK_SIZE) {
+        LocalSlot **blocks = (LocalSlot **)realloc(st->blocks, (st->blocks_len + 1) * sizeof(LocalSlot *));
+        if (!blocks) return;
+        st->blocks = blocks;
+        blocks[st->blocks_len] = (LocalSlot *)malloc(LOCAL_BLOCK_SIZE * sizeof(LocalSlot));
+        if (!blocks[st->blocks_len]) return;
+        st->blocks_len++;
+    }
+    if (st->len + 1 > st->buckets_cap && !local_buckets_resize(st, st->buckets_cap * 2)) {
+        return;
     }
-    scope->entries[scope->len].name = name;
-    scope->entries[scope->len].binding = b;
-    scope->len += 1;
+    size_t h = hash & (st->buckets_cap - 1);
+    LocalSlot *sl = local_slot(st, st->len);
+    sl->name = name;
+    sl->hash = hash;
+    sl->saved_gen = 0;
+    sl->next = st->buckets[h];
+    sl->binding = b;
+    st->buckets[h] = st->len++;
+}
+
+void locals_define(Locals *loc, Str name, Binding b) {
+    locals_define_hashed(loc, name, str_hash(name), b);
+}
+
+Binding *locals_lookup_hashed(Locals *loc, Str name, uint32_t hash) {
+    LocalStore *st = loc->store;
+    if (!st) return NULL;
+    size_t index;
+    LocalSlot *sl = locals_find(st, name, hash, &index);
+    if (!sl) return NULL;
+    locals_log(st, sl, index);
+    return &sl->binding;
 }
 
 Binding *locals_lookup(Locals *loc, Str name) {
-    for (size_t i = loc->len; i-- > 0;) {
-        LocalScope *scope = &loc->scopes[i];
-        LocalEntry *entry = locals_find_in_scope(scope, name);
-        if (entry) {
-            return &entry->binding;
-        }
-    }
-    return NULL;
+    return locals_lookup_hashed(loc, name, str_hash(name));
+}
+
+// Identifier nodes carry the hash the lexer computed for their name.
+static Binding *locals_lookup_ident(Locals *loc, Expr *id) {
+    return locals_lookup_hashed(loc, id->as.ident.name, str_hash_known(id->as.ident.name, id->as.ident.hash));
 }
 
 static Locals locals_clone(Locals *src) {
     Locals out;
-    out.scopes = NULL;
-    out.len = 0;
-    out.cap = 0;
-    if (!src) return out;
-    out.len = src->len;
-    out.cap = src->len;
-    out.scopes = (LocalScope *)malloc(out.cap * sizeof(LocalScope));
-    if (!out.scopes) {
-        out.len = 0;
-        out.cap = 0;
-        return out;
-    }
-    for (size_t i = 0; i < src->len; i++) {
-        LocalScope *s = &out.scopes[i];
-        LocalScope *os = &src->scopes[i];
-        s->len = os->len;
-        s->cap = os->len;
-        if (os->len == 0) {
-            s->entries = NULL;
-            continue;
-        }
-        s->entries = (LocalEntry *)malloc(os->len * sizeof(LocalEntry));
-        if (!s->entries) {
-            s->len = 0;
-            s->cap = 0;
-            continue;
-        }
-        memcpy(s->entries, os->entries, os->len * sizeof(LocalEntry));
-    }
+    memset(&out, 0, sizeof(out));
+    if (!src || !src->store) return out;
+    LocalStore *st = src->store;
+    out.store = st;
+    out.is_clone = true;
+    out.slot_mark = st->len;
+    out.undo_mark = st->undo_len;
+    out.scope_mark = st->scopes_len;
+    out.parent_slot_mark = st->clone_mark;
+    out.parent_gen = st->gen;
+    st->clone_mark = st->len;
+    st->gen = ++st->gen_counter;
     return out;
 }
 
+// ----------------------------
+// Type system helpers
+// ----------------------------
+
+typedef struct {
+    Str name;
+    Ty *ty;
+} SubstEntry;
+
+typedef struct {
+    SubstEntry *data;
+    size_t len;
+    size_t cap;
+} Subst;
+
 static bool set_errf(Diag *err, Str path, int line, int col, const char *fmt, ...) {
     if (!err) return false;
     char buf[512];
@@ -1811,70 +1929,71 @@ static Str normalize_import_name(Arena *arena, Str name) {
 }
 
 static ClassInfo *find_class(GlobalEnv *env, Str qname) {
-    for (size_t i = 0; i < env->classes_len; i++) {
-        if (str_eq(env->classes[i].qname, qname)) {
-            return &env->classes[i];
-        }
+    size_t idx;
+    if (strmap_get(&env->class_map, qname, &idx)) {
+        return &env->classes[idx];
     }
     return NULL;
 }
 
 static FunSig *find_fun(GlobalEnv *env, Str cask, Str name) {
-    for (size_t i = 0; i < env->funs_len; i++) {
-        if (str_eq(env->funs[i].cask, cask) && str_eq(env->funs[i].name, name)) {
-            return &env->funs[i];
-        }
+    char kbuf[256];
+    Str key = strmap_pair_key(kbuf, sizeof(kbuf), env->arena, cask, name);
+    size_t idx;
+    if (key.data && strmap_get(&env->fun_map, key, &idx)) {
+        return &env->funs[idx];
     }
     return NULL;
 }
 
 static ModuleImport *find_imports(GlobalEnv *env, Str cask) {
-    for (size_t i = 0; i < env->cask_imports_len; i++) {
-        if (str_eq(env->cask_imports[i].cask, cask)) {
-            return &env->cask_imports[i];
-        }
+    size_t idx;
+    if (strmap_get(&env->cask_imports_map, cask, &idx)) {
+        return &env->cask_imports[idx];
     }
     return NULL;
 }
 
 static ModuleConsts *find_cask_consts(GlobalEnv *env, Str cask) {
-    for (size_t i = 0; i < env->cask_consts_len; i++) {
-        if (str_eq(env->cask_consts[i].cask, cask)) {
-            return &env->cask_consts[i];
-        }
+    size_t idx;
+    if (strmap_get(&env->cask_consts_map, cask, &idx)) {
+        return &env->cask_consts[idx];
     }
     return NULL;
 }
 
 static ModuleGlobals *find_cask_globals(GlobalEnv *env, Str cask) {
-    for (size_t i = 0; i < env->cask_globals_len; i++) {
-        if (str_eq(env->cask_globals[i].cask, cask)) {
-            return &env->cask_globals[i];
-        }
+    size_t idx;
+    if (strmap_get(&env->cask_globals_map, cask, &idx)) {
+        return &env->cask_globals[idx];
     }
     return NULL;
 }
 
-static GlobalVar *find_global(ModuleGlobals *mg, Str name) {
-    if (!mg) return NULL;
-    for (size_t i = 0; i < mg->len; i++) {
-        if (str_eq(mg->vars[i].name, name)) {
-            return &mg->vars[i];
-        }
+static GlobalVar *find_global_hashed(ModuleGlobals *mg, Str name, uint32_t hash) {
+    size_t idx;
+    if (mg && strmap_get_hashed(&mg->index, name, hash, &idx)) {
+        return &mg->vars[idx];
     }
     return NULL;
 }
 
-static ConstEntry *find_const(ModuleConsts *mc, Str name) {
-    if (!mc) return NULL;
-    for (size_t i = 0; i < mc->len; i++) {
-        if (str_eq(mc->entries[i].name, name)) {
-            return &mc->entries[i];
-        }
+static GlobalVar *find_global(ModuleGlobals *mg, Str name) {
+    return find_global_hashed(mg, name, str_hash(name));
+}
+
+static ConstEntry *find_const_hashed(ModuleConsts *mc, Str name, uint32_t hash) {
+    size_t idx;
+    if (mc && strmap_get_hashed(&mc->index, name, hash, &idx)) {
+        return &mc->entries[idx];
     }
     return NULL;
 }
 
+static ConstEntry *find_const(ModuleConsts *mc, Str name) {
+    return find_const_hashed(mc, name, str_hash(name));
+}
+
 static bool is_cross_cask(Str from_cask, Str target_cask) {
     return !str_eq(from_cask, target_cask);
 }
@@ -2146,6 +2265,8 @@ GlobalEnv *build_global_env(Program *prog, Arena *arena, Diag *err) {
         set_err(err, "out of memory");
         return NULL;
     }
+    strmap_init(&env->cask_imports_map, arena, prog->mods_len);
+    strmap_init(&env->cask_globals_map, arena, prog->mods_len);
 
     for (size_t i = 0; i < prog->mods_len; i++) {
         Module *m = prog->mods[i];
@@ -2182,6 +2303,13 @@ GlobalEnv *build_global_env(Program *prog, Arena *arena, Diag *err) {
         env->cask_globals[i].cask = mod_name;
         env->cask_globals[i].vars = NULL;
         env->cask_globals[i].len = 0;
+        memset(&env->cask_globals[i].index, 0, sizeof(StrMap));
+        // First module wins when two share a cask name, as the scans did.
+        size_t prev;
+        if (!strmap_get(&env->cask_imports_map, mod_name, &prev)) {
+            strmap_put(&env->cask_imports_map, mod_name, i);
+            strmap_put(&env->cask_globals_map, mod_name, i);
+        }
     }
 
     // cask globals (def)
@@ -2198,11 +2326,13 @@ GlobalEnv *build_global_env(Program *prog, Arena *arena, Diag *err) {
             set_err(err, "out of memory");
             return NULL;
         }
+        strmap_init(&mg->index, arena, def_count);
         size_t idx = 0;
         for (size_t j = 0; j < m->decls_len; j++) {
             Decl *d = m->decls[j];
             if (d->kind != DECL_DEF) continue;
-            if (find_global(mg, d->as.def_decl.name)) {
+            uint32_t hash = str_hash_known(d->as.def_decl.name, d->as.def_decl.name_hash);
+            if (find_global_hashed(mg, d->as.def_decl.name, hash)) {
                 set_errf(err, m->path, d->line, d->col,
                          "%.*s: duplicate global '%.*s'",
                          (int)m->path.len, m->path.data,
@@ -2213,6 +2343,7 @@ GlobalEnv *build_global_env(Program *prog, Arena *arena, Diag *err) {
             mg->vars[idx].ty = NULL;
             mg->vars[idx].is_mut = d->as.def_decl.is_mut;
             mg->vars[idx].is_pub = d->as.def_decl.is_pub;
+            strmap_put_hashed(&mg->index, mg->vars[idx].name, hash, idx);
             idx++;
         }
         mg->len = idx;
@@ -2237,6 +2368,8 @@ GlobalEnv *build_global_env(Program *prog, Arena *arena, Diag *err) {
         set_err(err, "out of memory");
         return NULL;
     }
+    strmap_init(&env->class_map, arena, class_count);
+    strmap_init(&env->fun_map, arena, fun_count);
 
     // cask consts
     env->cask_consts_len = 0;
@@ -2245,6 +2378,7 @@ GlobalEnv *build_global_env(Program *prog, Arena *arena, Diag *err) {
         set_err(err, "out of memory");
         return NULL;
     }
+    strmap_init(&env->cask_consts_map, arena, prog->mods_len);
 
     for (size_t i = 0; i < prog->mods_len; i++) {
         Module *m = prog->mods[i];
@@ -2254,16 +2388,22 @@ GlobalEnv *build_global_env(Program *prog, Arena *arena, Diag *err) {
             if (m->decls[j]->kind == DECL_CONST) const_count++;
         }
         if (const_count == 0) continue;
+        size_t prev;
+        if (!strmap_get(&env->cask_consts_map, mod_name, &prev)) {
+            strmap_put(&env->cask_consts_map, mod_name, env->cask_consts_len);
+        }
         ModuleConsts *mc = &env->cask_consts[env->cask_consts_len++];
         mc->cask = mod_name;
         mc->len = const_count;
         mc->entries = const_count ? (ConstEntry *)arena_array(arena, const_count, sizeof(ConstEntry)) : NULL;
+        strmap_init(&mc->index, arena, const_count);
         size_t idx = 0;
         for (size_t j = 0; j < m->decls_len; j++) {
             Decl *d = m->decls[j];
             if (d->kind != DECL_CONST) continue;
             ConstDecl *cd = &d->as.const_decl;
-            if (find_const(mc, cd->name)) {
+            uint32_t hash = str_hash_known(cd->name, cd->name_hash);
+            if (find_const_hashed(mc, cd->name, hash)) {
                 set_errf(err, m->path, d->line, d->col,
                          "%.*s: duplicate const '%.*s'",
                          (int)m->path.len, m->path.data, (int)cd->name.len, cd->name.data);
@@ -2276,6 +2416,7 @@ GlobalEnv *build_global_env(Program *prog, Arena *arena, Diag *err) {
             mc->entries[idx].name = cd->name;
             mc->entries[idx].val = cv;
             mc->entries[idx].is_pub = cd->is_pub;
+            strmap_put_hashed(&mc->index, cd->name, hash, idx);
             idx++;
         }
     }
@@ -2297,6 +2438,9 @@ GlobalEnv *build_global_env(Program *prog, Arena *arena, Diag *err) {
                 ci->vis = str_from_c("pub");
                 ci->kind = CLASS_KIND_IFACE;
                 ci->cask_path = m->path;
+                if (!find_class(env, qname)) {
+                    strmap_put(&env->class_map, qname, (size_t)(ci - env->classes));
+                }
                 continue;
             }
             if (d->kind != DECL_CLASS) continue;
@@ -2318,6 +2462,7 @@ GlobalEnv *build_global_env(Program *prog, Arena *arena, Diag *err) {
             ci->base_qname = (Str){0};
             ci->kind = d->as.class_decl.kind;
             ci->cask_path = m->path;
+            strmap_put(&env->class_map, qname, (size_t)(ci - env->classes));
         }
     }
 
@@ -2492,15 +2637,20 @@ GlobalEnv *build_global_env(Program *prog, Arena *arena, Diag *err) {
                     return NULL;
                 }
                 // duplicate check
-                for (size_t k = 0; k < findex; k++) {
-                    if (str_eq(env->funs[k].cask, mod_name) && str_eq(env->funs[k].name, fd->name)) {
-                        set_errf(err, m->path, d->line, d->col,
-                                 "%.*s: duplicate function '%.*s'",
-                                 (int)m->path.len, m->path.data,
-                                 (int)fd->name.len, fd->name.data);
-                        return NULL;
-                    }
+                Str fun_key = strmap_pair_key(NULL, 0, arena, mod_name, fd->name);
+                size_t prev;
+                if (!fun_key.data) {
+                    set_err(err, "out of memory");
+                    return NULL;
                 }
+                if (strmap_get(&env->fun_map, fun_key, &prev)) {
+                    set_errf(err, m->path, d->line, d->col,
+                             "%.*s: duplicate function '%.*s'",
+                             (int)m->path.len, m->path.data,
+                             (int)fd->name.len, fd->name.data);
+                    return NULL;
+                }
+                strmap_put(&env->fun_map, fun_key, findex);
                 Ty *ret_ty = NULL;
                 if (fd->ret.is_void) {
                     ret_ty = ty_void(arena);
@@ -2596,7 +2746,7 @@ static Str shadowed_cask_name(Expr *base, Ctx *ctx, Locals *loc) {
     Str empty = {"", 0};
     if (!base || base->kind != EXPR_IDENT) return empty;
     Str name = base->as.ident.name;
-    if (!locals_lookup(loc, name)) return empty;
+    if (!locals_lookup_ident(loc, base)) return empty;
     if (str_eq(name, ctx->cask_name)) return name;
     for (size_t i = 0; i < ctx->imports_len; i++) {
         if (str_eq(ctx->imports[i], name)) return name;
@@ -2607,10 +2757,10 @@ static Str shadowed_cask_name(Expr *base, Ctx *ctx, Locals *loc) {
 static bool is_mut_lvalue(Expr *e, Ctx *ctx, Locals *loc, GlobalEnv *env) {
     if (!e) return false;
     if (e->kind == EXPR_IDENT) {
-        Binding *b = locals_lookup(loc, e->as.ident.name);
+        Binding *b = locals_lookup_ident(loc, e);
         if (b) return b->is_mut && !b->is_const && !b->is_moved;
         ModuleGlobals *mg = find_cask_globals(env, ctx->cask_name);
-        GlobalVar *gv = find_global(mg, e->as.ident.name);
+        GlobalVar *gv = find_global_hashed(mg, e->as.ident.name, str_hash_known(e->as.ident.name, e->as.ident.hash));
         return gv && gv->is_mut;
     }
     if (e->kind == EXPR_MEMBER) {
@@ -2950,7 +3100,8 @@ method_call:
 
     if (fn && fn->kind == EXPR_IDENT) {
         Str fname = fn->as.ident.name;
-        Binding *b = locals_lookup(loc, fname);
+        uint32_t fhash = str_hash_known(fname, fn->as.ident.hash);
+        Binding *b = locals_lookup_hashed(loc, fname, fhash);
         if (b) {
             Ty *fn_ty = tc_expr_inner(fn, ctx, loc, env, err);
             if (!fn_ty) {
@@ -2980,7 +3131,7 @@ method_call:
         }
 
         ModuleGlobals *mg = find_cask_globals(env, ctx->cask_name);
-        GlobalVar *gv = find_global(mg, fname);
+        GlobalVar *gv = find_global_hashed(mg, fname, fhash);
         if (gv) {
             if (!gv->ty) {
                 set_errf(err, ctx->cask_path, fn->line, fn->col, "%.*s: global '%.*s' used before definition",
@@ -3133,7 +3284,7 @@ method_call:
     return ret;
 }
 
-static Ty *tc_expr_inner(Expr *e, Ctx *ctx, Locals *loc, GlobalEnv *env, Diag *err) {
+static Ty *tc_expr_infer(Expr *e, Ctx *ctx, Locals *loc, GlobalEnv *env, Diag *err) {
     if (!e) return NULL;
     switch (e->kind) {
         case EXPR_INT:
@@ -3166,7 +3317,7 @@ static Ty *tc_expr_inner(Expr *e, Ctx *ctx, Locals *loc, GlobalEnv *env, Diag *e
             return ty_tuple(env->arena, items, n);
         }
         case EXPR_IDENT: {
-            Binding *b = locals_lookup(loc, e->as.ident.name);
+            Binding *b = locals_lookup_ident(loc, e);
             if (b) {
                 if (b->is_moved) {
                     set_errf(err, ctx->cask_path, e->line, e->col,
@@ -3181,7 +3332,7 @@ static Ty *tc_expr_inner(Expr *e, Ctx *ctx, Locals *loc, GlobalEnv *env, Diag *e
                 return ty_mod(env->arena, e->as.ident.name);
             }
             ModuleGlobals *mg = find_cask_globals(env, ctx->cask_name);
-            GlobalVar *gv = find_global(mg, e->as.ident.name);
+            GlobalVar *gv = find_global_hashed(mg, e->as.ident.name, str_hash_known(e->as.ident.name, e->as.ident.hash));
             if (gv) {
                 if (!gv->ty) {
                     set_errf(err, ctx->cask_path, e->line, e->col, "%.*s: global '%.*s' used before definition",
@@ -3368,7 +3519,7 @@ static Ty *tc_expr_inner(Expr *e, Ctx *ctx, Locals *loc, GlobalEnv *env, Diag *e
         case EXPR_ASSIGN: {
             TokKind op = is_assign_op(e->as.assign.op) ? e->as.assign.op : TOK_EQ;
             if (e->as.assign.target->kind == EXPR_IDENT) {
-                Binding *b = locals_lookup(loc, e->as.assign.target->as.ident.name);
+                Binding *b = locals_lookup_ident(loc, e->as.assign.target);
                 if (b) {
                     if (b->is_const) {
                         set_errf(err, ctx->cask_path, e->line, e->col, "%.*s: cannot assign to const '%.*s'", (int)ctx->cask_path.len, ctx->cask_path.data, (int)e->as.assign.target->as.ident.name.len, e->as.assign.target->as.ident.name.data);
@@ -3388,7 +3539,7 @@ static Ty *tc_expr_inner(Expr *e, Ctx *ctx, Locals *loc, GlobalEnv *env, Diag *e
                     return new_ty;
                 }
                 ModuleGlobals *mg = find_cask_globals(env, ctx->cask_name);
-                GlobalVar *gv = find_global(mg, e->as.assign.target->as.ident.name);
+                GlobalVar *gv = find_global_hashed(mg, e->as.assign.target->as.ident.name, str_hash_known(e->as.assign.target->as.ident.name, e->as.assign.target->as.ident.hash));
                 if (gv) {
                     if (!gv->is_mut) {
                         set_errf(err, ctx->cask_path, e->line, e->col, "%.*s: cannot assign to immutable '%.*s'", (int)ctx->cask_path.len, ctx->cask_path.data, (int)e->as.assign.target->as.ident.name.len, e->as.assign.target->as.ident.name.data);
@@ -3617,7 +3768,7 @@ static Ty *tc_expr_inner(Expr *e, Ctx *ctx, Locals *loc, GlobalEnv *env, Diag *e
                     ty = ty_from_type_ref(env, p->typ, ctx->cask_name, ctx->imports, ctx->imports_len, err);
                 }
                 Binding b = { ty, p->is_mut, false, false };
-                locals_define(&lambda_loc, p->name, b);
+                locals_define_hashed(&lambda_loc, p->name, str_hash_known(p->name, p->name_hash), b);
                 param_tys[i] = ty;
             }
             Ty *body_ty = tc_expr_inner(e->as.lambda.body, ctx, &lambda_loc, env, err);
@@ -3771,7 +3922,7 @@ static Ty *tc_expr_inner(Expr *e, Ctx *ctx, Locals *loc, GlobalEnv *env, Diag *e
                          (int)ctx->cask_path.len, ctx->cask_path.data);
                 return NULL;
             }
-            Binding *b = locals_lookup(loc, e->as.move.x->as.ident.name);
+            Binding *b = locals_lookup_ident(loc, e->as.move.x);
             if (!b) {
                 set_errf(err, ctx->cask_path, e->line, e->col,
                          "%.*s: move(...) is only supported on mutable local bindings",
@@ -3836,13 +3987,13 @@ static void tc_stmt_inner(Stmt *s, Ctx *ctx, Locals *loc, GlobalEnv *env, Ty *re
         case STMT_LET: {
             Ty *t = tc_expr_inner(s->as.let_s.expr, ctx, loc, env, err);
             Binding b = { t, s->as.let_s.is_mut, false, false };
-            locals_define(loc, s->as.let_s.name, b);
+            locals_define_hashed(loc, s->as.let_s.name, str_hash_known(s->as.let_s.name, s->as.let_s.name_hash), b);
             return;
         }
         case STMT_CONST: {
             Ty *t = tc_expr_inner(s->as.const_s.expr, ctx, loc, env, err);
             Binding b = { t, false, true, false };
-            locals_define(loc, s->as.const_s.name, b);
+            locals_define_hashed(loc, s->as.const_s.name, str_hash_known(s->as.const_s.name, s->as.const_s.name_hash), b);
             return;
         }
         case STMT_EXPR:
@@ -3934,7 +4085,7 @@ static void tc_stmt_inner(Stmt *s, Ctx *ctx, Locals *loc, GlobalEnv *env, Ty *re
             }
             locals_push(loc);
             Binding b = { elem, false, false, false };
-            locals_define(loc, s->as.foreach_s.name, b);
+            locals_define_hashed(loc, s->as.foreach_s.name, str_hash_known(s->as.foreach_s.name, s->as.foreach_s.name_hash), b);
             ctx->loop_depth++;
             tc_stmt_inner(s->as.foreach_s.body, ctx, loc, env, ret_ty, err);
             ctx->loop_depth--;
@@ -3955,6 +4106,14 @@ static void tc_stmt_inner(Stmt *s, Ctx *ctx, Locals *loc, GlobalEnv *env, Ty *re
     }
 }
 
+// Every expression check funnels through here so the inferred type is
+// recorded on the node; codegen reads Expr.ty back instead of re-inferring.
+static Ty *tc_expr_inner(Expr *e, Ctx *ctx, Locals *loc, GlobalEnv *env, Diag *err) {
+    Ty *t = tc_expr_infer(e, ctx, loc, env, err);
+    if (e && t) e->ty = t;
+    return t;
+}
+
 Ty *tc_expr(Expr *e, GlobalEnv *env, Str cask_path, Str cask_name, Str *imports, size_t imports_len, Diag *err) {
     Ctx ctx;
     ctx.cask_path = cask_path;
@@ -4225,7 +4384,7 @@ static void lint_call_args(Expr *call, Ctx *ctx, Locals *loc, GlobalEnv *env, Li
     size_t params_len = 0;
 
     if (fn && fn->kind == EXPR_IDENT) {
-        Binding *b = locals_lookup(loc, fn->as.ident.name);
+        Binding *b = locals_lookup_ident(loc, fn);
         if (b && b->ty && b->ty->tag == TY_FN) {
             params = b->ty->params;
             params_len = b->ty->params_len;
@@ -4296,7 +4455,7 @@ static void lint_expr(Expr *e, Ctx *ctx, Locals *loc, GlobalEnv *env, LintState
         case EXPR_ASSIGN: {
             Ty *target_ty = NULL;
             if (e->as.assign.target && e->as.assign.target->kind == EXPR_IDENT) {
-                Binding *b = locals_lookup(loc, e->as.assign.target->as.ident.name);
+                Binding *b = locals_lookup_ident(loc, e->as.assign.target);
                 if (b) target_ty = b->ty;
             }
             if (target_ty && ty_requires_non_null(target_ty)) {
@@ -4391,7 +4550,7 @@ static void lint_stmt(Stmt *s, Ctx *ctx, Locals *loc, GlobalEnv *env, Ty *ret_ty
             Diag tmp = {0};
             Ty *t = tc_expr_ctx(s->as.let_s.expr, ctx, loc, env, &tmp);
             Binding b = { t, s->as.let_s.is_mut, false, false };
-            locals_define(loc, s->as.let_s.name, b);
+            locals_define_hashed(loc, s->as.let_s.name, str_hash_known(s->as.let_s.name, s->as.let_s.name_hash), b);
             lint_expr(s->as.let_s.expr, ctx, loc, env, ls);
             return;
         }
@@ -4399,7 +4558,7 @@ static void lint_stmt(Stmt *s, Ctx *ctx, Locals *loc, GlobalEnv *env, Ty *ret_ty
             Diag tmp = {0};
             Ty *t = tc_expr_ctx(s->as.const_s.expr, ctx, loc, env, &tmp);
             Binding b = { t, false, true, false };
-            locals_define(loc, s->as.const_s.name, b);
+            locals_define_hashed(loc, s->as.const_s.name, str_hash_known(s->as.const_s.name, s->as.const_s.name_hash), b);
             lint_expr(s->as.const_s.expr, ctx, loc, env, ls);
             return;
         }
@@ -4439,7 +4598,7 @@ static void lint_stmt(Stmt *s, Ctx *ctx, Locals *loc, GlobalEnv *env, Ty *ret_ty
         case STMT_FOREACH:
             lint_expr(s->as.foreach_s.expr, ctx, loc, env, ls);
             locals_push(loc);
-            locals_define(loc, s->as.foreach_s.name, (Binding){ ty_prim(env->arena, "any"), false, false, false });
+            locals_define_hashed(loc, s->as.foreach_s.name, str_hash_known(s->as.foreach_s.name, s->as.foreach_s.name_hash), (Binding){ ty_prim(env->arena, "any"), false, false, false });
             lint_stmt(s->as.foreach_s.body, ctx, loc, env, ret_ty, ls);
             locals_pop(loc);
             return;
@@ -4488,7 +4647,7 @@ bool lint_program(Program *prog, Arena *arena, YisLintMode mode, int *warning_co
                 for (size_t p = 0; p < d->as.fun.params_len; p++) {
                     Param *pp = d->as.fun.params[p];
                     Ty *pty = ty_from_type_ref(env, pp->typ, mod_name, imports, imports_len, &err);
-                    locals_define(&loc, pp->name, (Binding){ pty, pp->is_mut, false, false });
+                    locals_define_hashed(&loc, pp->name, str_hash_known(pp->name, pp->name_hash), (Binding){ pty, pp->is_mut, false, false });
                 }
                 Ty *ret_ty = lint_ret_ty_from_spec(env, &d->as.fun.ret, mod_name, imports, imports_len, &err);
                 if (ret_ty && !ty_is_void(ret_ty) && !is_empty_body_stub(d->as.fun.body) && !stmt_guarantees_return(d->as.fun.body)) {
@@ -4522,7 +4681,7 @@ bool lint_program(Program *prog, Arena *arena, YisLintMode mode, int *warning_co
                         Param *pp = md->params[p];
                         Ty *pty = pp->is_this ? ty_class(env->arena, ci->qname)
                                               : ty_from_type_ref(env, pp->typ, mod_name, imports, imports_len, &err);
-                        locals_define(&loc, pp->name, (Binding){ pty, pp->is_mut, false, false });
+                        locals_define_hashed(&loc, pp->name, str_hash_known(pp->name, pp->name_hash), (Binding){ pty, pp->is_mut, false, false });
                     }
                     Ty *ret_ty = lint_ret_ty_from_spec(env, &md->ret, mod_name, imports, imports_len, &err);
                     if (ret_ty && !ty_is_void(ret_ty) && !is_empty_body_stub(md->body) && !stmt_guarantees_return(md->body)) {
@@ -4598,7 +4757,7 @@ bool typecheck_program(Program *prog, Arena *arena, Diag *err) {
                     Param *pp = d->as.fun.params[p];
                     Ty *pty = ty_from_type_ref(env, pp->typ, mod_name, imports, imports_len, err);
                     Binding b = { pty, pp->is_mut, false, false };
-                    locals_define(&loc, pp->name, b);
+                    locals_define_hashed(&loc, pp->name, str_hash_known(pp->name, pp->name_hash), b);
                 }
                 Ty *ret_ty = d->as.fun.ret.is_void ? ty_void(env->arena) : NULL;
                 if (!d->as.fun.ret.is_void) {
@@ -4650,7 +4809,7 @@ bool typecheck_program(Program *prog, Arena *arena, Diag *err) {
                         Param *pp = md->params[p];
                         Ty *pty = ty_from_type_ref(env, pp->typ, mod_name, imports, imports_len, err);
                         Binding b = { pty, pp->is_mut, false, false };
-                        locals_define(&loc, pp->name, b);
+                        locals_define_hashed(&loc, pp->name, str_hash_known(pp->name, pp->name_hash), b);
                     }
                     Ty *ret_ty = md->ret.is_void ? ty_void(env->arena) : NULL;
                     if (!md->ret.is_void) {
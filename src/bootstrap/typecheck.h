@@ -8,6 +8,7 @@
 #include "ast.h"
 #include "diag.h"
 #include "str.h"
+#include "strmap.h"
 
 typedef enum {
     TY_PRIM,
@@ -44,21 +45,20 @@ typedef struct {
     bool is_moved;
 } Binding;
 
-typedef struct {
-    Str name;
-    Binding binding;
-} LocalEntry;
-
-typedef struct {
-    LocalEntry *entries;
-    size_t len;
-    size_t cap;
-} LocalScope;
+typedef struct LocalStore LocalStore;
 
+// Handle on a scope chain of local bindings. Every binding lives in one
+// hashed LocalStore; locals_clone only records a mark on it, and freeing the
+// clone rolls back whatever was defined or changed since. Clones must be
+// freed before their source is used again.
 typedef struct {
-    LocalScope *scopes;
-    size_t len;
-    size_t cap;
+    LocalStore *store;
+    bool is_clone;
+    size_t slot_mark;
+    size_t undo_mark;
+    size_t scope_mark;
+    size_t parent_slot_mark;
+    unsigned parent_gen;
 } Locals;
 
 typedef struct {
@@ -93,6 +93,7 @@ typedef struct {
     Str cask;
     ConstEntry *entries;
     size_t len;
+    StrMap index;  // name -> index into entries
 } ModuleConsts;
 
 typedef struct {
@@ -106,6 +107,7 @@ typedef struct {
     Str cask;
     GlobalVar *vars;
     size_t len;
+    StrMap index;  // name -> index into vars
 } ModuleGlobals;
 
 typedef struct {
@@ -178,6 +180,12 @@ typedef struct {
     size_t cask_consts_len;
     ModuleGlobals *cask_globals;
     size_t cask_globals_len;
+    // Hashed indexes over the arrays above, filled by build_global_env.
+    StrMap class_map;         // qname -> index into classes
+    StrMap fun_map;           // "cask\0name" -> index into funs
+    StrMap cask_imports_map;  // cask -> index into cask_imports
+    StrMap cask_consts_map;   // cask -> index into cask_consts
+    StrMap cask_globals_map;  // cask -> index into cask_globals
     Arena *arena;
 } GlobalEnv;
 
@@ -200,5 +208,8 @@ void locals_push(Locals *loc);
 void locals_pop(Locals *loc);
 void locals_define(Locals *loc, Str name, Binding b);
 Binding *locals_lookup(Locals *loc, Str name);
+// Same, with str_hash(name) supplied by a caller that already has it.
+void locals_define_hashed(Locals *loc, Str name, uint32_t hash, Binding b);
+Binding *locals_lookup_hashed(Locals *loc, Str name, uint32_t hash);
 
 #endif
@@ -0,0 +1,5 @@
+// Yis runtime library (libyisrt.a): runtime.inc compiled once with external
+// linkage. `yis run` links programs against it and emits only the runtime's
+// interface (YIS_RT_INTERFACE) into the generated C.
+#define YIS_RT_LIB 1
+#include "runtime.inc"
@@ -0,0 +1,20 @@
+#!/bin/sh
+# Compiles num_counter.yi and checks the generated C: the num locals keep
+# plain arithmetic, and only the string local appends in place.
+# Usage: num_counter.sh <yis> <source root>
+set -e
+yis="$1"
+root="$2"
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+cd "$work"
+YIS_STDLIB="$root/src/stdlib" "$yis" "$root/tests/num_counter.yi" >/dev/null 2>&1 || true
+test -f num_counter.c
+for v in v_i v_total; do
+  if grep -q "yis_append_into(&$v," num_counter.c; then
+    echo "num local $v goes through yis_append_into" >&2
+    exit 1
+  fi
+done
+grep -q "yis_append_into(&v_s," num_counter.c
+test "$(./num_counter)" = "n=20"